@@ -26,6 +26,7 @@ import uuid
 
 from . import fea, vfb
 from .designspace import designspace
+from .dump import dump, interpolate
 from .fdk import fdk
 from .fea import features
 from .glif import glifs
@@ -52,6 +53,11 @@ def write_ufo(options):
   ufo = parse_options(options)
   copy_master_info(ufo)
 
+  if ufo.opts.instance_interpolate:
+    interpolate(ufo)
+  elif ufo.opts.dump_path:
+    dump(ufo)
+
   for instance in ufo.instances:
 
     add_instance(ufo, *instance)
@@ -67,6 +73,8 @@ def write_ufo(options):
 
     finish(ufo, instance=1)
 
+  ufo.interpolation = None
+
   if ufo.opts.designspace_export:
     designspace(ufo)
 
@@ -167,6 +175,24 @@ def parse_options(options):
         b".flc file or set 'force_overwrite' to True." % opts.groups_export_flc_path
         )
 
+  if opts.dump_path:
+    if os_path_isfile(opts.dump_path) and not opts.force_overwrite:
+      raise RuntimeError(
+        b'%s already exists.\nPlease rename or move existing '
+        b"glyph dump or set 'force_overwrite' to True." % opts.dump_path
+        )
+
+  if opts.instance_interpolate:
+    if ufo.instance_from_master:
+      opts.instance_interpolate = 0
+    elif (opts.glyphs_decompose or opts.glyphs_remove_overlaps or opts.glyphs_optimize_makeotf or
+        opts.glyphs_decompose_names or opts.glyphs_remove_overlap_names):
+      raise RuntimeError(
+        b"'instance_interpolate' not currently supported for use with glyph "
+        b"decomposition or overlap removal.\nPlease set 'glyphs_decompose', "
+        b"'glyphs_remove_overlaps' and 'glyphs_optimize_makeotf' to False."
+        )
+
   if opts.groups_plist_path and os_path_basename(opts.groups_plist_path).endswith('groups.plist'):
     ufo.paths.groups_plist = opts.groups_plist_path
 
@@ -209,6 +235,14 @@ def parse_options(options):
   if not opts.glyphs_decompose:
     opts.glyphs_optimize = 0
 
+  if opts.ufoz_compress_policy and opts.ufoz_compress_policy not in UFOZ_COMPRESS_POLICIES:
+    raise ValueError(
+      b"'ufoz_compress_policy' must be one of %s" % ', '.join(sorted(UFOZ_COMPRESS_POLICIES))
+      )
+
+  if not isinstance(opts.ufoz_memory_limit, (int, long)) or opts.ufoz_memory_limit < 0:
+    raise ValueError(b"'ufoz_memory_limit' must be a whole number of megabytes")
+
   if opts.glyphs_optimize_names:
     opts.glyphs_optimize_names = encode_string_list(opts.glyphs_optimize_names)
 
@@ -324,7 +358,7 @@ def build_paths(ufo, master=0):
 
     for path in check_paths:
       if os_path_exists(path):
-        if not ufo.opts.force_overwrite:
+        if not ufo.opts.force_overwrite and not ufo.opts.incremental:
           raise IOError(b"%s already exists.\nPlease remove directory/file "
             b"or set 'force_overwrite' to True" % path)
       if 'masters' in path:
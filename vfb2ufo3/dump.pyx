@@ -0,0 +1,268 @@
+# coding: utf-8
+# cython: wraparound=False
+# cython: boundscheck=False
+# cython: infer_types=True
+# cython: cdivision=True
+# cython: auto_pickle=False
+# cython: c_string_type=unicode
+# cython: c_string_encoding=utf_8
+# distutils: language=c++
+# distutils: extra_compile_args=[-O2, -fopenmp, -fconcepts, -Wno-register, -fno-strict-aliasing, -std=c++17]
+# distutils: extra_link_args=[-fopenmp, -lz]
+from __future__ import division, unicode_literals, print_function
+include 'includes/future.pxi'
+
+cimport cython
+from .glif cimport c_instances
+from .mark cimport c_marks
+from .vfb cimport c_master_glif
+from libcpp.string cimport string
+from libcpp.utility cimport move
+from libcpp_vector cimport vector
+
+include 'includes/dump.pxi'
+
+import os
+
+from FL import fl, Font
+
+from .glif import prep_glyph_hints
+
+include 'includes/path.pxi'
+
+def dump(ufo):
+
+  '''
+  write the master font to a binary glyph dump for the headless converter
+  (`src/headless.cpp`)
+  '''
+
+  cdef dump_writer *writer = new_writer(ufo)
+  try:
+    dump_masters(ufo, writer)
+    write_dump(ufo, writer)
+  finally:
+    del writer
+
+def interpolate(ufo):
+
+  '''
+  build the glifs, kerning and mark anchors of every instance from one reading
+  of the master font
+
+  the masters are read into a glyph dump held in memory, and all instances are
+  interpolated from it in parallel before the first instance is written;
+  glifs() and kerning() then take each instance from `ufo.interpolation` in
+  place of reading the glyphs of the FontLab instance font, which is still
+  generated for the font info, names and features
+  '''
+
+  cdef:
+    dump_writer *writer = new_writer(ufo)
+    c_instances instances = c_instances()
+    vector[vector[double]] values
+    vector[string] glyphs_paths
+    string data
+    string error
+    int hint_type = 0
+    bint ufoz = ufo.opts.ufoz
+    float scale = ufo.scale if ufo.scale is not None else 0.0
+    char path_sep = b'\\'
+    c_marks marks = c_marks()
+
+  try:
+    dump_masters(ufo, writer)
+    if ufo.opts.dump_path:
+      write_dump(ufo, writer)
+    data = writer.data()
+  finally:
+    del writer
+
+  error = instances.instances.load(move(data))
+  if not error.empty():
+    raise RuntimeError(error)
+
+  if ufoz:
+    path_sep = b'/'
+
+  if ufo.opts.glyphs_hints_afdko_v1:
+    hint_type = 1
+  elif ufo.opts.glyphs_hints_afdko_v2:
+    hint_type = 2
+  elif ufo.opts.glyphs_hints:
+    hint_type = 3
+
+  if ufo.opts.mark_feature_generate:
+    marks.set_anchors(ufo.mark_classes, ufo.mark_bases)
+
+  # glif paths are placed as build_instance_paths() places the glyphs
+  # directory of each instance
+  for index, value, name, attributes, path in ufo.instances:
+    ufo_path = os_path_basename(path) if ufoz else path
+    values.push_back(value)
+    glyphs_paths.push_back(os_path_join(ufo_path, 'glyphs').encode('utf_8'))
+
+  with nogil:
+    instances.instances.build(values, glyphs_paths, hint_type, ufoz, scale, path_sep, marks.marks[0])
+
+  ufo.interpolation = instances
+
+
+cdef dump_writer *new_writer(ufo):
+  master = fl[ufo.master.ifont]
+  return new dump_writer(len(master.axis), master.upm, ufo.master.family_name.encode('utf_8'))
+
+
+cdef write_dump(ufo, dump_writer *writer):
+
+  cdef:
+    string path = ufo.opts.dump_path.encode('utf_8')
+    int error = writer.write(path)
+
+  if error:
+    raise IOError(b'%s: %s' % (ufo.opts.dump_path, os.strerror(error)))
+
+
+cdef dump_masters(ufo, dump_writer *writer):
+
+  '''
+  add the glyphs and kerning of the master font to a glyph dump
+
+  every glyph is added with its coordinates for each master, after the
+  conversions glifs() makes on an instance; hint links are converted to hints
+  and replace tables rebuilt on a copy of the master so the user's font is
+  left untouched
+  '''
+
+  master = fl[ufo.master.ifont]
+  masters = 2 ** len(master.axis)
+  build_hints = ufo.opts.glyphs_hints or ufo.opts.glyphs_hints_afdko_v1 or ufo.opts.glyphs_hints_afdko_v2
+  vertical_hints_only = ufo.opts.glyphs_hints_vertical_only
+
+  cdef:
+    c_master_glif master_glif
+    bint has_hints = 0
+
+  font = master
+  if build_hints:
+    fl.Add(Font(master))
+    ifont = fl.ifont
+    font = fl[ifont]
+
+  try:
+    for i, master_glif in sorted(items(ufo.glifs)):
+      glyph = font[i]
+      has_hints = build_hints and bool(glyph.hhints or glyph.vhints or glyph.hlinks or glyph.vlinks)
+      if has_hints:
+        had_replace_table = bool(glyph.replace_table)
+        prep_glyph_hints(glyph, vertical_hints_only, had_replace_table)
+
+      writer.add_glyph(
+        i,
+        master_glif.name,
+        master_glif.glif_name,
+        master_glif.mark,
+        master_glif.code_points,
+        master_glif.omit,
+        master_glif.base,
+        has_hints,
+        [glyph.GetMetrics(m).x for m in range(masters)],
+        )
+
+      if glyph.nodes:
+        dump_contours(glyph, writer, masters, has_hints)
+
+      for component in glyph.components:
+        j = component.index
+        writer.add_component(
+          ufo.glyph_names[j].encode('utf_8'),
+          j,
+          [delta.x for delta in component.deltas],
+          [delta.y for delta in component.deltas],
+          [scale.x for scale in component.scales],
+          [scale.y for scale in component.scales],
+          )
+
+      for anchor in glyph.anchors:
+        layers = [anchor.Layer(m) for m in range(masters)]
+        writer.add_anchor(
+          anchor.name.decode('cp1252').encode('utf_8'),
+          [point.x for point in layers],
+          [point.y for point in layers],
+          )
+
+      if has_hints:
+        for hint in glyph.vhints:
+          writer.add_hint(hint.positions, hint.widths, 1, hint.width == -20 or hint.width == -21)
+        for hint in glyph.hhints:
+          writer.add_hint(hint.positions, hint.widths, 0, hint.width == -20 or hint.width == -21)
+        if had_replace_table:
+          for replacement in glyph.replace_table:
+            writer.add_replacement(replacement.type, replacement.index)
+  finally:
+    if build_hints:
+      fl.Close(ifont)
+
+  for i, glyph in enumerate(master.glyphs):
+    for kern in glyph.kerning:
+      writer.add_kern_pair(i, kern.key, list(kern.values))
+
+
+cdef dump_contours(glyph, dump_writer *writer, size_t masters, bint has_hints):
+
+  '''
+  add the contours of a glyph as cpp_outlines.add_nodes builds them, with the
+  point coordinates of every master
+  '''
+
+  cdef:
+    bint off = 0, cubic = 1
+    size_t contour_points = 0
+    int alignment = 0
+    int hintset = -1
+
+  replacement_nodes = {0}
+  if has_hints and glyph.replace_table:
+    for replacement in glyph.replace_table:
+      if replacement.type == 255:
+        replacement_nodes.add(replacement.index)
+
+  writer.add_contour()
+  for i, node in enumerate(glyph.nodes):
+
+    if node.type == 17:
+      start_node = node[0]
+      if contour_points:
+        writer.add_contour()
+        contour_points = 0
+
+    layers = [node.Layer(m) for m in range(masters)]
+    hintset = i if has_hints and i in replacement_nodes else -1
+
+    if node.count > 1:
+      cubic = 1
+      alignment = node.alignment
+      writer.add_point([layer[1].x for layer in layers], [layer[1].y for layer in layers])
+      writer.add_point([layer[2].x for layer in layers], [layer[2].y for layer in layers])
+      contour_points += 2
+      if start_node == node[0]:
+        writer.set_point([layer[0].x for layer in layers], [layer[0].y for layer in layers], 1, alignment, hintset)
+      else:
+        writer.add_point([layer[0].x for layer in layers], [layer[0].y for layer in layers], 1, alignment, hintset)
+        contour_points += 1
+    elif node.type == 65:
+      off = 1
+      cubic = 0
+      writer.add_point([layer[0].x for layer in layers], [layer[0].y for layer in layers])
+      contour_points += 1
+    elif cubic:
+      alignment = node.alignment
+      writer.add_point([layer[0].x for layer in layers], [layer[0].y for layer in layers], 3, alignment, hintset)
+      contour_points += 1
+    elif off:
+      writer.add_point([layer[0].x for layer in layers], [layer[0].y for layer in layers], 2)
+      contour_points += 1
+      off = 0
+    else:
+      writer.add_point([layer[0].x for layer in layers], [layer[0].y for layer in layers], 3, 0, hintset)
+      contour_points += 1
@@ -3,15 +3,38 @@
 from libcpp.string cimport string
 from libcpp_unordered_map cimport unordered_map
 from libcpp_vector cimport vector
+from .kern cimport c_kerning, cpp_kern_pair
+from .mark cimport c_marks, cpp_marks
+
+cdef extern from 'src/archive.cpp' namespace 'zip' nogil:
+  cdef cppclass zip_file:
+    zip_file(string, bint, size_t, string, bint)
+    size_t copied
+    void reserve(size_t)
+    void add_entry(string, string)
+    string close()
 
 cdef class c_archive:
   cdef:
     string filename
     bint compress
-    unordered_map[string, string] files
+    zip_file *archive
 
-cdef extern from 'src/archive.cpp' namespace 'zip' nogil:
-  cdef void write_archive(string, unordered_map[string, string], bint)
+cdef extern from 'src/manifest.cpp' nogil:
+  cdef cppclass cpp_manifest:
+    cpp_manifest(string)
+    size_t written
+    size_t skipped
+    vector[string] finish()
+
+cdef class c_manifest:
+  cdef cpp_manifest *manifest
+
+cdef extern from 'src/schedule.cpp' nogil:
+  cdef cppclass thread_times:
+    vector[double] busy
+    vector[double] idle
+    vector[size_t] items
 
 cdef extern from 'src/glif.cpp' nogil:
   cdef cppclass cpp_hint
@@ -19,26 +42,41 @@ cdef extern from 'src/glif.cpp' nogil:
   cdef cppclass cpp_anchor
   cdef cppclass cpp_component
 
-  cdef cppclass cpp_contour_point:
-    string name
-    int type
-    size_t index
-    cpp_contour_point()
-    cpp_contour_point(float, float)
-    cpp_contour_point(float, float, int)
-    cpp_contour_point(float, float, int, int)
-    cpp_contour_point(float, float, int, int, int)
-    cpp_contour_point(float, float, int, int, string)
+  cdef cppclass cpp_outline:
+    size_t start
+    size_t end
+    size_t size()
+
+  cdef cppclass cpp_outlines:
+    vector[float] x
+    vector[size_t] contours
+    void reserve(size_t, size_t)
+    void add_contour()
+    void add_point(float, float)
+    void add_point(float, float, int)
+    void add_point(float, float, int, int)
+    void add_point(float, float, int, int, int)
+    void set_point(size_t, float, float, int, int)
+    void set_point(size_t, float, float, int, int, int)
+    cpp_outline add_nodes(cpp_nodes&, bint)
 
-  ctypedef vector[cpp_contour_point] cpp_contour
-  ctypedef vector[cpp_contour] cpp_contours
+  cdef cppclass cpp_nodes:
+    vector[size_t] contours
+    size_t points
+    void clear()
+    void add_node(int, int, float, float)
+    void add_node(int, int, float, float, float, float, float, float)
+    void add_replacement(size_t)
 
   cdef cppclass cpp_ufo:
     vector[cpp_glif] glifs
-    unordered_map[size_t, cpp_contours*] contours
+    cpp_outlines outlines
+    unordered_map[size_t, cpp_outline] contours
+    thread_times times
     int hint_type
     bint optimize
     bint ufoz
+    cpp_manifest *manifest
     void reserve(size_t)
 
   cdef cppclass cpp_glif:
@@ -49,12 +87,26 @@ cdef extern from 'src/glif.cpp' nogil:
     vector[cpp_hint] vhints
     vector[cpp_hint] hhints
     vector[cpp_hint_replacement] hint_replacements
-    vector[cpp_contour] contours
+    cpp_outline outline
     size_t index
     cpp_glif()
     cpp_glif(string, string, int, float, size_t, size_t, bint, bint)
-    void scale(float)
+    void scale(float, cpp_outlines&)
     string repr(...)
 
-  cdef void write_glifs(...)
+  cdef vector[string] write_glifs(...)
+  cdef void archive_glifs(...)
+
 
+cdef extern from 'src/instance.cpp' nogil:
+  cdef cppclass cpp_instances:
+    vector[cpp_ufo] ufos
+    vector[vector[cpp_kern_pair]] kerning
+    vector[cpp_marks] marks
+    string load(string)
+    void build(vector[vector[double]], vector[string], int, bint, float, char, cpp_marks&)
+    void release(size_t)
+
+cdef class c_instances:
+  cdef:
+    cpp_instances *instances
@@ -14,13 +14,15 @@ include 'includes/future.pxi'
 
 cimport cython
 cimport fenv
+from libc.stdint cimport SIZE_MAX, uint64_t
 from .vfb cimport c_master_glif
-from cython.operator cimport postincrement
 from libcpp.string cimport string
 from libcpp.utility cimport move
 from libcpp_vector cimport vector
 
 include 'includes/archive.pxi'
+include 'includes/instance.pxi'
+include 'includes/manifest.pxi'
 
 import time
 
@@ -51,8 +53,30 @@ def _glifs(ufo):
   and the cached contour will be substituted in its place in the outline
   element of the .glif file, and shifted and/or scaled (if necessary) to match
   the component being replaced
+
+  with `instance_interpolate`, the glifs were built by interpolate() and are
+  written as they are
+
+  for mark feature generation, the anchors of the instance are indexed into
+  `ufo.instance.marks` before the glifs are scaled
   '''
 
+  cdef:
+    c_instances instances
+    c_marks marks = None
+
+  if ufo.opts.mark_feature_generate:
+    marks = c_marks()
+
+  if ufo.interpolation is not None:
+    instances = ufo.interpolation
+    if marks is not None:
+      instances.marks(ufo.instance.index, marks)
+    ufo.instance.marks = marks
+    write_ufo_glifs(ufo, instances.instances.ufos[ufo.instance.index])
+    instances.release(ufo.instance.index)
+    return
+
   font = fl[ufo.instance.ifont]
 
   base_glyphs = ufo.glyph_sets.bases
@@ -62,11 +86,10 @@ def _glifs(ufo):
   cdef:
     c_master_glif master_glif
     size_t i = 0
-    size_t len_contours = 0
     size_t len_points = 0
     cpp_ufo ufo_lib
     cpp_glif glif
-    string instance_ufoz_path = ufo.paths.instance.ufoz.encode('utf_8')
+    cpp_nodes nodes
     float ufo_scale = ufo.scale if ufo.scale is not None else 0.0
     bytes name
     string glif_path
@@ -103,10 +126,6 @@ def _glifs(ufo):
     glyph = font[i]
     width = max(glyph.width * ufo_scale, 0)
     has_hints = bool(glyph.hhints or glyph.vhints or glyph.hlinks or glyph.vlinks)
-    len_contours = 0
-    for node in glyph.nodes:
-      if node.type == 17:
-        postincrement(len_contours)
     len_points = len(glyph.Layer(0))
 
     glif = cpp_glif(
@@ -139,23 +158,57 @@ def _glifs(ufo):
       if had_replace_table:
         glif_hint_replacements(glyph.replace_table, glif.hint_replacements)
 
-    if len_points and build_hints and has_hints:
-      glif_contours_hints(glyph, glif, ufo_lib, len_contours, len_points)
-    elif len_points:
-      glif_contours(glyph, glif, ufo_lib, len_contours, len_points)
-
-    if ufo_scale:
-      glif.scale(ufo_scale)
+    if len_points:
+      glif_nodes(glyph, nodes)
+      if build_hints and has_hints:
+        glif_replacement_nodes(glyph, nodes)
+      glif.outline = ufo_lib.outlines.add_nodes(nodes, build_hints and has_hints)
+      ufo_lib.contours[glif.index] = glif.outline
 
     ufo_lib.glifs.push_back(move(glif))
 
-  if ufoz:
-    ufo.archive = c_archive(instance_ufoz_path, ufo.opts.ufoz_compress)
-    ufo.archive.reserve(ufo_lib.glifs.size() + 10)
-    for glif in ufo_lib.glifs:
-      ufo.archive[glif.path] = glif.repr(ufo_lib)
+  if marks is not None:
+    marks.set_anchors(ufo.mark_classes, ufo.mark_bases)
+    with nogil:
+      marks.marks.scan(ufo_lib.glifs)
+  ufo.instance.marks = marks
+
+  if ufo_scale:
+    for i in range(ufo_lib.glifs.size()):
+      ufo_lib.glifs[i].scale(ufo_scale, ufo_lib.outlines)
+
+  write_ufo_glifs(ufo, ufo_lib)
+
+
+cdef write_ufo_glifs(ufo, cpp_ufo &ufo_lib):
+
+  cdef:
+    c_archive archive
+    c_manifest manifest = None
+    vector[string] errors
+    string instance_ufoz_path = ufo.paths.instance.ufoz.encode('utf_8')
+
+  if ufo.opts.ufoz:
+    ufo.archive = archive = c_archive(
+      instance_ufoz_path,
+      ufo.opts.ufoz_compress,
+      ufo.opts.ufoz_memory_limit,
+      ufo.opts.ufoz_compress_policy or '',
+      ufo.opts.incremental,
+      )
+    archive.reserve(ufo_lib.glifs.size() + 10)
+    archive_glifs(ufo_lib, archive.archive[0])
   else:
-    write_glifs(ufo_lib)
+    if ufo.opts.incremental:
+      manifest = c_manifest((ufo.paths.instance.ufo + '.manifest').encode('utf_8'))
+      ufo_lib.manifest = manifest.manifest
+    ufo.instance.manifest = manifest
+    errors = write_glifs(ufo_lib)
+    ufo_lib.manifest = NULL
+    if not errors.empty():
+      raise IOError('\n'.join(errors))
+
+  ufo.instance_times.glif_threads = tuple(zip(ufo_lib.times.busy, ufo_lib.times.idle, ufo_lib.times.items))
 
 def convert_links_to_hints(glyph):
   fl.TransformGlyph(glyph, 10, b'')
@@ -281,122 +334,37 @@ cdef glif_hint_replacements(glyph_replace_table, vector[cpp_hint_replacement] &h
     hint_replacements.emplace_back(<int>replacement.type, <size_t>replacement.index)
 
 
-cdef glif_contours(glyph, cpp_glif &glif, cpp_ufo &ufo, size_t n_contours, size_t n_points):
+cdef glif_nodes(glyph, cpp_nodes &nodes):
+
+  '''
+  read the type, alignment and points of each node of a glyph into flat
+  buffers in one pass; the contours are built from them in C++ by
+  cpp_outlines.add_nodes
+  '''
 
   cdef:
-    cpp_contour contour
-    bint off = 0, cubic = 1
+    int node_type = 0
     long x0 = 0, x1 = 0, x2 = 0
     long y0 = 0, y1 = 0, y2 = 0
-    int alignment = 0
 
-  glif.contours.reserve(n_contours+1)
-  contour.reserve(n_points+2)
+  nodes.clear()
   for node in glyph.nodes:
-
-    if node.type == 17:
-      start_node = node[0]
-      if not contour.empty():
-        glif.contours.push_back(contour)
-        contour.clear()
-
+    node_type = node.type
     if node.count > 1:
-      cubic = 1
-      x0, y0 = node.points[1].x, node.points[1].y
-      x1, y1 = node.points[2].x, node.points[2].y
-      x2, y2 = node.x, node.y
-      alignment = node.alignment
-      contour.emplace_back(x0, y0)
-      contour.emplace_back(x1, y1)
-      if start_node == node[0]:
-        contour[0] = cpp_contour_point(x2, y2, 1, alignment)
-      else:
-        contour.emplace_back(x2, y2, 1, alignment)
+      points = node.points
+      x0, y0 = node.x, node.y
+      x1, y1 = points[1].x, points[1].y
+      x2, y2 = points[2].x, points[2].y
+      nodes.add_node(node_type, node.alignment, x0, y0, x1, y1, x2, y2)
     else:
       x0, y0 = node.x, node.y
-      if node.type == 65:
-        off = 1
-        cubic = 0
-        contour.emplace_back(x0, y0)
-      elif cubic:
-        alignment = node.alignment
-        contour.emplace_back(x0, y0, 3, alignment)
-      elif off:
-        contour.emplace_back(x0, y0, 2)
-        off = 0
-      else:
-        contour.emplace_back(x0, y0, 3)
-
-  glif.contours.push_back(contour)
-  ufo.contours[glif.index] = &glif.contours
+      nodes.add_node(node_type, node.alignment, x0, y0)
 
 
-cdef glif_contours_hints(glyph, cpp_glif &glif, cpp_ufo &ufo, size_t n_contours, size_t n_points):
+cdef glif_replacement_nodes(glyph, cpp_nodes &nodes):
 
-  cdef:
-    cpp_contour contour
-    string name
-    bint off = 0, cubic = 1
-    long x0 = 0, x1 = 0, x2 = 0
-    long y0 = 0, y1 = 0, y2 = 0
-    int alignment = 0
-
-  replacement_nodes = {0}
+  nodes.add_replacement(0)
   if glyph.replace_table:
     for replacement in glyph.replace_table:
       if replacement.type == 255:
-        replacement_nodes.add(replacement.index)
-
-  glif.contours.reserve(n_contours+1)
-  contour.reserve(n_points+2)
-  for i, node in enumerate(glyph.nodes):
-
-    if node.type == 17:
-      start_node = node[0]
-      if not contour.empty():
-        glif.contours.push_back(contour)
-        contour.clear()
-
-    if node.count > 1:
-      cubic = 1
-      x0, y0 = node.points[1].x, node.points[1].y
-      x1, y1 = node.points[2].x, node.points[2].y
-      x2, y2 = node.x, node.y
-      alignment = node.alignment
-      contour.emplace_back(x0, y0)
-      contour.emplace_back(x1, y1)
-      if start_node == node[0]:
-        if i in replacement_nodes:
-          contour[0] = cpp_contour_point(x2, y2, 1, alignment, <int>i)
-        else:
-          contour[0] = cpp_contour_point(x2, y2, 1, alignment, contour[0].name)
-      else:
-        if i in replacement_nodes:
-          contour.emplace_back(x2, y2, 1, alignment, <int>i)
-        else:
-          contour.emplace_back(x2, y2, 1, alignment)
-    elif node.type == 65:
-      off = 1
-      cubic = 0
-      x0, y0 = node.x, node.y
-      contour.emplace_back(x0, y0)
-    elif cubic:
-      x0, y0 = node.x, node.y
-      alignment = node.alignment
-      if i in replacement_nodes:
-        contour.emplace_back(x0, y0, 3, alignment, <int>i)
-      else:
-        contour.emplace_back(x0, y0, 3, alignment)
-    elif off:
-      x0, y0 = node.x, node.y
-      contour.emplace_back(x0, y0, 2)
-      off = 0
-    else:
-      x0, y0 = node.x, node.y
-      if i in replacement_nodes:
-        contour.emplace_back(x0, y0, 3, 0, <int>i)
-      else:
-        contour.emplace_back(x0, y0, 3)
-
-  glif.contours.push_back(contour)
-  ufo.contours[glif.index] = &glif.contours
+        nodes.add_replacement(<size_t>replacement.index)
@@ -3,18 +3,29 @@
 @cython.final
 cdef class c_archive:
 
-  def __init__(self, string &filename, bint compress):
+  def __cinit__(self, string &filename, bint compress, uint64_t memory_limit=0, string policy=b'', bint update=False):
+    # the limit is given in megabytes and is shifted in 64 bits, then clamped
+    # to what size_t holds on 32-bit builds
+    memory_limit = min(memory_limit, <uint64_t>SIZE_MAX >> 20) << 20
     self.filename = filename
     self.compress = compress
+    self.archive = new zip_file(filename, compress, <size_t>memory_limit, policy, update)
+
+  def __dealloc__(self):
+    del self.archive
 
   def __reduce__(self):
     return self.__class__
 
   def __setitem__(self, string &arc_name, string &text):
-    self.files.emplace(arc_name, move(text))
+    self.archive.add_entry(arc_name, move(text))
 
   def reserve(self, size_t n):
-    self.files.reserve(n)
+    self.archive.reserve(n)
 
   def write(self):
-    write_archive(self.filename, self.files, self.compress)
+
+    cdef string error = self.archive.close()
+
+    if not error.empty():
+      raise IOError(error)
@@ -46,6 +46,8 @@ UFO_INSTANCE = (
   ('fontinfo', None),
   ('name_records', None),
   ('kerning', None),
+  ('marks', None),
+  ('manifest', None),
   )
 
 UFO_TIMES_TOTAL = (
@@ -67,6 +69,7 @@ UFO_TIMES_INSTANCE = (
   ('kern', 0.0),
   ('fontinfo', 0.0),
   ('afdko', 0.0),
+  ('glif_threads', ()),
   )
 
 UFO_PLISTS = (
@@ -174,6 +177,7 @@ UFO_BASE = [
   ('lib', None),
   ('layercontents', None),
   ('archive', None),
+  ('interpolation', None),
   ('glyph_contents', None),
   ('glyph_names', None),
   ('glyph_order', None),
@@ -0,0 +1,20 @@
+# dump.pxi
+
+cdef extern from 'src/dump.cpp' nogil:
+  cdef cppclass dump_writer:
+    dump_writer(size_t, size_t, string)
+    void add_glyph(size_t, string, string, int, vector[long], bint, bint, bint, vector[float])
+    void add_contour()
+    void add_point(vector[float], vector[float])
+    void add_point(vector[float], vector[float], int)
+    void add_point(vector[float], vector[float], int, int)
+    void add_point(vector[float], vector[float], int, int, int)
+    void set_point(vector[float], vector[float], int, int)
+    void set_point(vector[float], vector[float], int, int, int)
+    void add_component(string, size_t, vector[float], vector[float], vector[float], vector[float])
+    void add_anchor(string, vector[float], vector[float])
+    void add_hint(vector[float], vector[float], bint, bint)
+    void add_replacement(int, size_t)
+    void add_kern_pair(size_t, size_t, vector[float])
+    string data()
+    int write(string)
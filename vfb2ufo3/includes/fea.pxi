@@ -215,6 +215,11 @@ def fea_kern_lookup(label, lookup):
     ]
   return lookup
 
+def KernSubtableWarning(group):
+  print(b" KernSubtableWarning: The class pairs of kerning group '%s' do not fit"
+    b' in a single\n kern subtable. Reduce the pairs or seconds of the group.'
+    % group.encode('cp1252'))
+
 def fea_feature(label, feature):
   feature = '\n'.join(feature)
   return f'feature {label} {{ # {FEATURES[label]}\n{feature}\n}} {label};'
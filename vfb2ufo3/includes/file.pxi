@@ -2,4 +2,12 @@
 
 cdef extern from 'src/file.cpp' nogil:
   string read_file(string)
-  void write_file(string, string)
+  string cpp_write_file 'write_file'(string, string)
+
+
+cdef write_file(string path, string data):
+
+  cdef string error = cpp_write_file(path, data)
+
+  if not error.empty():
+    raise IOError(error)
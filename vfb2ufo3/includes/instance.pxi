@@ -0,0 +1,22 @@
+# instance.pxi
+
+@cython.final
+cdef class c_instances:
+
+  def __cinit__(self):
+    self.instances = new cpp_instances()
+
+  def __dealloc__(self):
+    del self.instances
+
+  def __reduce__(self):
+    return self.__class__
+
+  def kerning(self, size_t index, c_kerning kerning):
+    kerning.kerning.add_pairs(self.instances.kerning[index])
+
+  def marks(self, size_t index, c_marks marks):
+    marks.marks[0] = move(self.instances.marks[index])
+
+  def release(self, size_t index):
+    self.instances.release(index)
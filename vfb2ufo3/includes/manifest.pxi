@@ -0,0 +1,33 @@
+# manifest.pxi
+
+@cython.final
+cdef class c_manifest:
+
+  def __cinit__(self, string &path):
+    self.manifest = new cpp_manifest(path)
+
+  def __dealloc__(self):
+    del self.manifest
+
+  def __reduce__(self):
+    return self.__class__
+
+  @property
+  def written(self):
+    return self.manifest.written
+
+  @property
+  def skipped(self):
+    return self.manifest.skipped
+
+  def finish(self):
+
+    '''
+    remove the files of the previous run that were not written again and
+    write the manifest
+    '''
+
+    cdef vector[string] errors = self.manifest.finish()
+
+    if not errors.empty():
+      raise IOError('\n'.join(errors))
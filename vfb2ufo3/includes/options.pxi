@@ -80,11 +80,17 @@ DEFAULT_OPTIONS = (
 
   ('ufoz', False),
   ('ufoz_compress', True),
+  ('ufoz_compress_policy', None),
+  ('ufoz_memory_limit', 0),
+
+  ('dump_path', None),
+  ('instance_interpolate', False),
 
   ('designspace_export', False),
   ('designspace_default', []),
 
   ('force_overwrite', False),
+  ('incremental', False),
 
   ('report', True),
   ('report_verbose', False),
@@ -101,8 +107,17 @@ PATH_OPTIONS = {
   'output_path',
   'afdko_makeotf_output_dir',
   'groups_export_flc_path',
+  'dump_path',
   } | FILE_OPTIONS
 
+UFOZ_COMPRESS_POLICIES = {
+  'default',
+  'fast',
+  'balanced',
+  'best',
+  'zstd',
+  }
+
 INSTANCE_OPTIONS = {
   'instance_values',
   'instance_names',
@@ -0,0 +1,57 @@
+# plist_writer.pxi
+
+cdef extern from 'src/plist.cpp' nogil:
+  cdef cppclass cpp_plist:
+    void reserve(size_t)
+    void begin_dict()
+    void end_dict()
+    void begin_array()
+    void end_array()
+    void add_key(string)
+    void add_string(string)
+    void add_integer(long)
+    void add_real(double)
+    void add_bool(bint)
+    string finish()
+
+
+cdef string plist_doc(plist, size_t reserve=4096):
+
+  '''
+  stream a plist of dicts, lists, strings, integers, reals and booleans into
+  one buffer, laid out as the element builders in `xml.pxi` lay it out
+
+  byte strings are taken as cp1252, as FontLab gives them, and dict items
+  with a value of None are left out
+  '''
+
+  cdef cpp_plist writer
+  writer.reserve(reserve)
+  plist_value(writer, plist)
+  return writer.finish()
+
+
+cdef void plist_value(cpp_plist &writer, value) except *:
+
+  if isinstance(value, bool):
+    writer.add_bool(value)
+  elif isinstance(value, bytes):
+    writer.add_string(value.decode('cp1252'))
+  elif isinstance(value, unicode):
+    writer.add_string(value)
+  elif isinstance(value, (int, long)):
+    writer.add_integer(value)
+  elif isinstance(value, float):
+    writer.add_real(value)
+  elif isinstance(value, dict):
+    writer.begin_dict()
+    for key, item in items(value):
+      if item is not None:
+        writer.add_key(key.decode('cp1252') if isinstance(key, bytes) else key)
+        plist_value(writer, item)
+    writer.end_dict()
+  elif isinstance(value, (list, tuple)):
+    writer.begin_array()
+    for item in value:
+      plist_value(writer, item)
+    writer.end_array()
@@ -0,0 +1,38 @@
+# kern.pxd
+
+from libcpp.string cimport string
+from libcpp_vector cimport vector
+
+cdef extern from 'src/kern.cpp' nogil:
+  cdef cppclass cpp_kern_pair:
+    size_t first
+    size_t second
+    long value
+
+  cdef cppclass cpp_kern_record:
+    unsigned int first
+    unsigned int second
+    int value
+
+  cdef cppclass cpp_kern_feature:
+    string lines
+    size_t subtables
+    vector[string] oversize
+
+  cdef cppclass cpp_kerning:
+    vector[cpp_kern_record] records
+    void set_glyphs(vector[string], vector[string], vector[string])
+    void reserve(size_t)
+    void add_pair(size_t, size_t, long)
+    void add_pairs(vector[cpp_kern_pair]&)
+    void set_groups(vector[size_t], vector[size_t])
+    void sort()
+    size_t size()
+    string first(cpp_kern_record&)
+    string second(cpp_kern_record&)
+    string plist()
+    cpp_kern_feature feature(long)
+
+cdef class c_kerning:
+  cdef:
+    cpp_kerning *kerning
@@ -4,20 +4,23 @@
 # cython: infer_types=True
 # cython: cdivision=True
 # cython: auto_pickle=False
-# distutils: extra_compile_args=[-O2, -fno-strict-aliasing]
+# cython: c_string_type=unicode
+# cython: c_string_encoding=utf_8
+# distutils: language=c++
+# distutils: extra_compile_args=[-O2, -fopenmp, -fconcepts, -Wno-register, -fno-strict-aliasing, -std=c++17]
+# distutils: extra_link_args=[-fopenmp]
 from __future__ import division, unicode_literals
 include 'includes/future.pxi'
 
 cimport cython
-from cpython.dict cimport PyDict_SetItem
-from libc.stdlib cimport abs
+from libcpp.string cimport string
+from libcpp_vector cimport vector
 
 import time
 
 from FL import fl
 
 include 'includes/fea.pxi'
-include 'includes/ordered_dict.pxi'
 
 def kerning(ufo, font):
   start = time.clock()
@@ -27,131 +30,99 @@ def kerning(ufo, font):
 def kern_feature(ufo):
   return _kern_feature(ufo)
 
-cdef inline int pair_calc(int n_glyphs):
 
-  '''
-  find the number of possible pairs for a number of glyphs
+@cython.final
+cdef class c_kerning:
 
-  >>> pair_calc(20)
-  190
-  >>> pair_calc(10)
-  45
-  '''
+  def __cinit__(self):
+    self.kerning = new cpp_kerning()
 
-  cdef int n_pairs = (n_glyphs * (n_glyphs - 1)) / 2
-  return n_pairs
+  def __dealloc__(self):
+    del self.kerning
 
-def _kerning(ufo, font):
+  def __reduce__(self):
+    return self.__class__
 
-  instance_kerning = _instance_kerning(ufo, font, ufo.scale)
+  def __len__(self):
+    return self.kerning.size()
 
-  if instance_kerning:
-    ufo.instance.kerning = ordered_dict()
-    for first, kerning_pairs in sorted(items(instance_kerning)):
-      if first in ufo.kern.firsts_by_key_glyph:
-        first = ufo.kern.firsts_by_key_glyph[first]
-      kerns = ordered_dict()
-      for second, value in sorted(kerning_pairs):
-        if second in ufo.kern.seconds_by_key_glyph:
-          second = ufo.kern.seconds_by_key_glyph[second]
-        kerns[second] = value
-      ufo.instance.kerning[first] = kerns
+  def pairs(self):
 
+    '''
+    sorted (first, second, value) pairs, with key glyphs written as their
+    kerning groups
+    '''
 
-def _instance_kerning(ufo, font, scale):
+    return [(self.kerning.first(record), self.kerning.second(record), record.value)
+      for record in self.kerning.records]
 
-  def kern_pair(kern):
-    if scale is not None:
-      return ufo.glyph_names[kern.key], int(kern.value * scale)
-    return ufo.glyph_names[kern.key], kern.value
 
-  kerning = {}
-  for i, glyph in enumerate(font.glyphs):
-    if glyph.kerning:
-      kerning[ufo.glyph_names[i]] = [kern_pair(kern) for kern in glyph.kerning]
+def _kerning(ufo, font):
 
-  return kerning
+  cdef:
+    c_kerning table = c_kerning()
+    vector[string] names, firsts, seconds
+    vector[size_t] first_sizes, second_sizes
 
+  for name in ufo.glyph_names:
+    first = ufo.kern.firsts_by_key_glyph.get(name)
+    second = ufo.kern.seconds_by_key_glyph.get(name)
+    names.push_back(name)
+    firsts.push_back(first if first is not None else name)
+    seconds.push_back(second if second is not None else name)
+    first_sizes.push_back(ufo.kern.glyphs_len[first] if first is not None else 0)
+    second_sizes.push_back(ufo.kern.glyphs_len[second] if second is not None else 0)
+  table.kerning.set_glyphs(names, firsts, seconds)
+  table.kerning.set_groups(first_sizes, second_sizes)
 
-def _kern_feature(ufo):
+  if ufo.interpolation is not None:
+    ufo.interpolation.kerning(ufo.instance.index, table)
+  else:
+    _instance_kerning(font, ufo.scale, table)
 
-  cdef:
-    long CHECK_LIMIT = 700_000
-    long BLOCK_LIMIT = 720_000 # first subtable
-    long STEP = 208_000        # step down for subsequent subtables
-    long new_kerns = 0
-    int MIN_VALUE = 0
-    int value = 0
-    int n_glyphs = 0
-    int kerns = 0
-    int subtables = 0
-    bint check_next = 0
-    bint first_group = 0
-    bint second_group = 0
+  table.kerning.sort()
+  if table.kerning.size():
+    ufo.instance.kerning = table
 
-  if ufo.opts.kern_min_value is not None:
-    MIN_VALUE = ufo.opts.kern_min_value
-
-  pair_calcs = {}
-  feature, no_block, block = [], [], []
-  first_enum_block, second_enum_block = [], []
-  for first, kerning_pairs in ufo.instance.kerning.items():
-    first_group = 0
-    if kerns > CHECK_LIMIT:
-      check_next = 1
-    if 'public.kern' in first:
-      first_group = 1
-    for second, value in kerning_pairs.items():
-      second_group = 0
-      if abs(value) < MIN_VALUE:
-        continue
-      if 'public.kern' in second:
-        second_group = 1
-      if first_group and second_group:
-        n_glyphs = ufo.kern.glyphs_len[first] + ufo.kern.glyphs_len[second]
-        if n_glyphs not in pair_calcs:
-          new_kerns = pair_calc(n_glyphs)
-          pair_calcs[n_glyphs] = new_kerns
-        else:
-          new_kerns = pair_calcs[n_glyphs]
-        if check_next:
-          if kerns + new_kerns > BLOCK_LIMIT:
-            if not feature:
-              CHECK_LIMIT -= STEP
-              BLOCK_LIMIT -= STEP
-            block.append('\tsubtable;')
-            subtables += 1
-            feature += block
-            block = [f'\tpos @{first} @{second} {value};']
-            kerns = new_kerns
-            check_next = 0
-            continue
-        kerns += new_kerns
-        block.append(f'\tpos @{first} @{second} {value};')
-      elif first_group:
-        first_enum_block.append(f'\tenum pos @{first} {second} {value};')
-      elif second_group:
-        second_enum_block.append(f'\tenum pos {first} @{second} {value};')
+
+cdef _instance_kerning(font, scale, c_kerning table):
+
+  cdef size_t i, n_glyphs = len(font.glyphs)
+
+  for i, glyph in enumerate(font.glyphs):
+    for kern in glyph.kerning:
+      if not 0 <= kern.key < n_glyphs:
+        raise IndexError(b"Kerning pair of glyph '%s' refers to glyph index %d, "
+          b"but the font has %d glyphs." % (glyph.name, kern.key, n_glyphs))
+      if scale is not None:
+        table.kerning.add_pair(i, kern.key, int(kern.value * scale))
       else:
-        no_block.append(f'\tpos {first} {second} {value};')
+        table.kerning.add_pair(i, kern.key, kern.value)
 
-  feature += block
 
-  if first_enum_block:
-    first_enum_block.append('\tsubtable;')
-  if second_enum_block:
-    second_enum_block.append('\tsubtable;')
+def _kern_feature(ufo):
 
-  feature = no_block + first_enum_block + second_enum_block + feature
+  cdef:
+    c_kerning table = ufo.instance.kerning
+    cpp_kern_feature pairs
+    long min_value = 0
 
-  if subtables:
-    feature = fea_lookup('kern1', feature, kern=1)
+  if ufo.opts.kern_min_value is not None:
+    min_value = ufo.opts.kern_min_value
 
-  groups = []
+  feature = []
   if ufo.opts.features_import_groups:
-    groups = [fea_group(name, glyphs, 1)
+    feature = [fea_group(name, glyphs, 1)
       for name, (_, glyphs) in sorted(items(ufo.groups.kerning))]
 
-  feature = groups + feature
+  pairs = table.kerning.feature(min_value)
+  for name in pairs.oversize:
+    KernSubtableWarning(name)
+  lines = pairs.lines
+  if lines:
+    if pairs.subtables > 1:
+      feature += fea_lookup('kern1', lines.split('\n'), kern=1)
+    else:
+      feature.append(lines)
 
   return fea_feature('kern', feature)
@@ -0,0 +1,14 @@
+# mark.pxd
+
+from libcpp.string cimport string
+from libcpp_vector cimport vector
+
+cdef extern from 'src/mark.cpp' nogil:
+  cdef cppclass cpp_marks:
+    void set_anchors(vector[string], vector[string])
+    void scan(...)
+    string feature(double)
+
+cdef class c_marks:
+  cdef:
+    cpp_marks *marks
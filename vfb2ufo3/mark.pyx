@@ -4,74 +4,68 @@
 # cython: infer_types=True
 # cython: cdivision=True
 # cython: auto_pickle=False
-# distutils: extra_compile_args=[-O2, -fno-strict-aliasing]
+# cython: c_string_type=unicode
+# cython: c_string_encoding=utf_8
+# distutils: language=c++
+# distutils: extra_compile_args=[-O2, -fopenmp, -fconcepts, -Wno-register, -fno-strict-aliasing, -std=c++17]
+# distutils: extra_link_args=[-fopenmp]
 from __future__ import division, unicode_literals
 include 'includes/future.pxi'
 
+cimport cython
 cimport fenv
-from libc.math cimport nearbyint
-
-cdef double SCALE = 1.0
-
-from collections import defaultdict
-import time
-
-from FL import fl
+from libcpp.string cimport string
+from libcpp_vector cimport vector
 
 include 'includes/fea.pxi'
 
 def mark_feature(ufo):
   return _mark_feature(ufo)
 
+
+@cython.final
+cdef class c_marks:
+
+  def __cinit__(self):
+    self.marks = new cpp_marks()
+
+  def __dealloc__(self):
+    del self.marks
+
+  def __reduce__(self):
+    return self.__class__
+
+  def set_anchors(self, mark_classes, mark_bases):
+
+    '''
+    set the anchor names to index from the cp1252 names of the mark classes
+    and base anchors
+    '''
+
+    cdef vector[string] classes, bases
+
+    for name in mark_classes:
+      classes.push_back(name.decode('cp1252').encode('utf_8'))
+    for name in mark_bases:
+      bases.push_back(name.decode('cp1252').encode('utf_8'))
+    self.marks.set_anchors(classes, bases)
+
+
 def _mark_feature(ufo):
 
-  if ufo.scale is not None:
-    global SCALE
-    SCALE = ufo.scale
+  cdef:
+    c_marks marks = ufo.instance.marks
+    double scale = ufo.scale if ufo.scale is not None else 1.0
+    string feature
+
+  if marks is None:
+    return ''
 
-  font = fl[ufo.instance.ifont]
   fenv.set_nearest()
 
-  mark_classes = set()
-  bases = defaultdict(list)
-  for i, glyph in enumerate(font.glyphs):
-    if i in ufo.glyph_sets.omit:
-      continue
-    if glyph.anchors:
-      for anchor in glyph.anchors:
-        if anchor.name:
-          if anchor.name.startswith(b'_'):
-            anchor_name = anchor.name[1:]
-            if anchor_name in ufo.mark_classes:
-              mark_classes.add(mark_class(ufo.glyph_names[i], anchor))
-              continue
-          if anchor.name in ufo.mark_classes:
-            bases[ufo.glyph_names[i]].append(anchor)
-
-  mark_bases = defaultdict(list)
-  for base, anchors in items(bases):
-    for anchor in anchors:
-      if anchor.name in ufo.mark_bases:
-        mark_bases[anchor.name].append(mark_base(base, anchor))
-
-  mark_bases = list(values(mark_bases))
-  mark_lookups = [fea_lookup(f'mark{i}', sorted(bases))
-    for i, bases in enumerate(mark_bases, start=1)]
-  mark_classes = '\n'.join(sorted(mark_classes))
-
-  lookups = '\n'.join(f'\tlookup mark{i+1};' for i in range(len(mark_bases)))
-
-  feature = [mark_classes, *mark_lookups, lookups]
-  return fea_feature('mark', feature) if mark_bases else ''
-
-def int_anchor_coords(double x, double y):
-  x, y = nearbyint(x * SCALE), nearbyint(y * SCALE)
-  return int(x), int(y)
-
-def mark_class(parent, anchor):
-  x, y = int_anchor_coords(anchor.x, anchor.y)
-  return f'\tmarkClass {parent} <anchor {x} {y}> @{anchor.name[1:].decode("cp1252")};'
-
-def mark_base(base, anchor):
-  x, y = int_anchor_coords(anchor.x, anchor.y)
-  return f'\tpos base {base} <anchor {x} {y}> mark @{anchor.name.decode("cp1252")};'
+  with nogil:
+    feature = marks.marks.feature(scale)
+
+  if feature.empty():
+    return ''
+  return fea_feature('mark', [feature])
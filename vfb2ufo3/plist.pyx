@@ -8,13 +8,16 @@
 # cython: c_string_encoding=utf_8
 # distutils: language=c++
 # distutils: extra_compile_args=[-O2, -fopenmp, -fconcepts, -Wno-register, -fno-strict-aliasing, -std=c++17]
-# distutils: extra_link_args=[-fopenmp]
+# distutils: extra_link_args=[-fopenmp, -lz]
 from __future__ import division, unicode_literals
 include 'includes/future.pxi'
 
 cimport cython
 from cpython.dict cimport PyDict_SetItem
+from .glif cimport c_archive, c_manifest, cpp_manifest
+from .kern cimport c_kerning
 from libcpp.string cimport string
+from libcpp.utility cimport move
 from libcpp_vector cimport vector
 
 import os
@@ -29,7 +32,7 @@ include 'includes/thread.pxi'
 include 'includes/path.pxi'
 include 'includes/files.pxi'
 include 'includes/plist.pxi'
-include 'includes/xml.pxi'
+include 'includes/plist_writer.pxi'
 include 'includes/ordered_dict.pxi'
 
 def plists(ufo):
@@ -39,7 +42,10 @@ def plists(ufo):
 
 def _plists(ufo):
 
-  cdef vector[cpp_file] files
+  cdef:
+    vector[cpp_file] files
+    vector[string] errors
+    c_manifest manifest = ufo.instance.manifest
 
   if not ufo.opts.ufoz:
     files.reserve(7)
@@ -53,14 +59,37 @@ def _plists(ufo):
   layercontents(ufo, files)
 
   if not ufo.opts.ufoz:
-    write_files(files)
+    if manifest is not None:
+      errors = write_files(files, manifest.manifest)
+    else:
+      errors = write_files(files)
+    if not errors.empty():
+      raise IOError('\n'.join(errors))
+    if manifest is not None:
+      manifest.finish()
+      ufo.instance.manifest = None
+
+
+cdef add_plist(ufo, vector[cpp_file] &files, string &path, string &plist):
+
+  '''
+  hand a plist to the instance archive, or queue it to be written
+  '''
+
+  cdef c_archive archive
+
+  if ufo.opts.ufoz:
+    archive = ufo.archive
+    archive.archive.add_entry(path, move(plist))
+  else:
+    files.emplace_back(path, move(plist))
 
 
 cdef metainfo(ufo, vector[cpp_file] &files):
 
   cdef:
     string path = ufo.paths.instance.metainfo
-    bytes plist
+    string plist
 
   if ufo.plists.metainfo:
     copy_file(ufo.plists.metainfo, ufo.paths.instance.metainfo)
@@ -71,11 +100,9 @@ cdef metainfo(ufo, vector[cpp_file] &files):
   metainfo['formatVersion'] = 3
 
   plist = plist_doc(metainfo)
+  add_plist(ufo, files, path, plist)
 
-  if ufo.opts.ufoz:
-    ufo.archive[path] = plist
-  else:
-    files.emplace_back(path, plist)
+  if not ufo.opts.ufoz:
     ufo.plists.metainfo = ufo.paths.instance.metainfo
 
 
@@ -83,32 +110,26 @@ cdef fontinfo(ufo, vector[cpp_file] &files):
 
   cdef:
     string path = ufo.paths.instance.fontinfo
-    bytes plist
+    string plist
 
   plist = plist_doc(ufo.instance.fontinfo)
-
-  if ufo.opts.ufoz:
-    ufo.archive[path] = plist
-  else:
-    files.emplace_back(path, plist)
+  add_plist(ufo, files, path, plist)
 
 
 cdef groups(ufo, vector[cpp_file] &files):
 
   cdef:
     string path = ufo.paths.instance.groups
-    bytes plist
+    string plist
 
   if ufo.groups.all and ufo.plists.groups:
     copy_file(ufo.plists.groups, ufo.paths.instance.groups)
     return
 
-  plist = plist_doc(ufo.groups.all)
+  plist = plist_doc(ufo.groups.all, 1 << 20)
+  add_plist(ufo, files, path, plist)
 
-  if ufo.opts.ufoz:
-    ufo.archive[path] = plist
-  else:
-    files.emplace_back(path, plist)
+  if not ufo.opts.ufoz:
     ufo.plists.groups = ufo.paths.instance.groups
 
 
@@ -116,21 +137,20 @@ cdef kerning(ufo, vector[cpp_file] &files):
 
   cdef:
     string path = ufo.paths.instance.kerning
-    bytes plist
+    string plist
+    c_kerning table
 
   if ufo.instance.kerning:
-    plist = plist_doc(ufo.instance.kerning)
-    if ufo.opts.ufoz:
-      ufo.archive[path] = plist
-    else:
-      files.emplace_back(path, plist)
+    table = ufo.instance.kerning
+    plist = table.kerning.plist()
+    add_plist(ufo, files, path, plist)
 
 
 cdef lib(ufo, vector[cpp_file] &files):
 
   cdef:
     string path = ufo.paths.instance.lib
-    bytes plist
+    string plist
 
   if ufo.plists.lib:
     copy_file(ufo.plists.lib, ufo.paths.instance.lib)
@@ -142,12 +162,10 @@ cdef lib(ufo, vector[cpp_file] &files):
   lib['com.schriftgestaltung.disablesLastChange'] = True
   lib['com.schriftgestaltung.useNiceNames'] = False
 
-  plist = plist_doc(lib)
+  plist = plist_doc(lib, 1 << 16)
+  add_plist(ufo, files, path, plist)
 
-  if ufo.opts.ufoz:
-    ufo.archive[path] = plist
-  else:
-    files.emplace_back(path, plist)
+  if not ufo.opts.ufoz:
     ufo.plists.lib = ufo.paths.instance.lib
 
 
@@ -155,7 +173,7 @@ cdef glyphs_contents(ufo, vector[cpp_file] &files):
 
   cdef:
     string path = ufo.paths.instance.glyphs_contents
-    bytes plist
+    string plist
 
   if ufo.plists.glyphs_contents:
     copy_file(ufo.plists.glyphs_contents, ufo.paths.instance.glyphs_contents)
@@ -168,12 +186,10 @@ cdef glyphs_contents(ufo, vector[cpp_file] &files):
     if i not in ufo.glyph_sets.omit:
       glyph_contents[ufo.glyph_names[i]] = ufo.glifs[i].glif_name
 
-  plist = plist_doc(glyph_contents)
+  plist = plist_doc(glyph_contents, 1 << 16)
+  add_plist(ufo, files, path, plist)
 
-  if ufo.opts.ufoz:
-    ufo.archive[path] = plist
-  else:
-    files.emplace_back(path, plist)
+  if not ufo.opts.ufoz:
     ufo.plists.glyphs_contents = ufo.paths.instance.glyphs_contents
 
 
@@ -181,7 +197,7 @@ cdef layercontents(ufo, vector[cpp_file] &files):
 
   cdef:
     string path = ufo.paths.instance.layercontents
-    bytes plist
+    string plist
 
   if ufo.plists.layercontents:
     copy_file(ufo.plists.layercontents, ufo.paths.instance.layercontents)
@@ -190,9 +206,7 @@ cdef layercontents(ufo, vector[cpp_file] &files):
   layercontents = [['public.default', 'glyphs']]
 
   plist = plist_doc(layercontents)
+  add_plist(ufo, files, path, plist)
 
-  if ufo.opts.ufoz:
-    ufo.archive[path] = plist
-  else:
-    files.emplace_back(path, plist)
+  if not ufo.opts.ufoz:
     ufo.plists.layercontents = ufo.paths.instance.layercontents
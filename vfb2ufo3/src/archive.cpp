@@ -1,27 +1,75 @@
 // archive.cpp
 
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <omp.h>
+
 #include "zlib.h"
+#ifdef ZIP_ZSTD_SUPPORT
+#include "zstd.h"
+#endif
 
+#include "arena.cpp"
 #include "archive.hpp"
 
 namespace zip {
 
+static inline std::uint32_t zip32(std::uint64_t n) {
+  return n < ZIP64_LIMIT ? n : ZIP64_LIMIT;
+  }
+
+// renames from over to; where rename does not replace an existing file, to
+// is moved aside first and moved back if from cannot take its place
+static inline bool replace_file(const std::string &from, const std::string &to) {
+#ifdef _WIN32
+  std::string backup = to + ".bak";
+  std::remove(backup.c_str());
+  if (std::rename(to.c_str(), backup.c_str()) != 0)
+    return false;
+  if (std::rename(from.c_str(), to.c_str()) != 0) {
+    int error = errno;
+    std::rename(backup.c_str(), to.c_str());
+    errno = error;
+    return false;
+    }
+  std::remove(backup.c_str());
+  return true;
+#else
+  return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+  }
+
+// little-endian field of a record read from an archive
+template <typename T>
+static inline T field(const char *record, size_t offset) {
+  T value;
+  std::memcpy(&value, record + offset, sizeof(T));
+  return value;
+  }
+
 zip_info::zip_info(
     const std::string &arc_name,
     std::uint16_t compression_method,
     std::uint16_t time,
     std::uint16_t date,
-    std::uint32_t uncompressed_size,
-    std::uint32_t compressed_size,
+    std::uint64_t uncompressed_size,
+    std::uint64_t compressed_size,
     std::uint32_t crc,
-    std::uint32_t header_offset
+    std::uint64_t header_offset
     ) {
   this->arc_name = arc_name;
   this->compression_method = compression_method;
@@ -32,15 +80,35 @@ zip_info::zip_info(
   this->crc = crc;
   this->header_offset = header_offset;
   }
+bool zip_info::zip64_sizes() const {
+  return this->uncompressed_size >= ZIP64_LIMIT or this->compressed_size >= ZIP64_LIMIT;
+  }
+bool zip_info::zip64() const {
+  return this->zip64_sizes() or this->header_offset >= ZIP64_LIMIT;
+  }
+std::uint16_t zip_info::version_needed() const {
+  if (this->compression_method == ZIP_ZSTD)
+    return ZIP_ZSTD_VERSION;
+  if (this->zip64())
+    return ZIP64_VERSION;
+  return ZIP_VERSION;
+  }
 
 local_file_header::local_file_header(const zip_info &zinfo) {
   this->compression_method = zinfo.compression_method;
   this->time = zinfo.time;
   this->date = zinfo.date;
   this->crc = zinfo.crc;
-  this->compressed_size = zinfo.compressed_size;
-  this->uncompressed_size = zinfo.uncompressed_size;
+  this->compressed_size = zip32(zinfo.compressed_size);
+  this->uncompressed_size = zip32(zinfo.uncompressed_size);
   this->arc_name_len = zinfo.arc_name.size();
+  this->version_needed = zinfo.version_needed();
+  // the local zip64 extra field must hold both sizes when either overflows
+  if (zinfo.zip64_sizes()) {
+    this->compressed_size = ZIP64_LIMIT;
+    this->uncompressed_size = ZIP64_LIMIT;
+    this->extra_field_len = 20;
+    }
   }
 
 central_directory_header::central_directory_header(const zip_info &zinfo) {
@@ -48,58 +116,379 @@ central_directory_header::central_directory_header(const zip_info &zinfo) {
   this->time = zinfo.time;
   this->date = zinfo.date;
   this->crc = zinfo.crc;
-  this->compressed_size = zinfo.compressed_size;
-  this->uncompressed_size = zinfo.uncompressed_size;
+  this->compressed_size = zip32(zinfo.compressed_size);
+  this->uncompressed_size = zip32(zinfo.uncompressed_size);
   this->file_name_len = zinfo.arc_name.size();
-  this->relative_header_offset = zinfo.header_offset;
+  this->relative_header_offset = zip32(zinfo.header_offset);
+  this->version_made_by = zinfo.version_needed();
+  this->version_needed = zinfo.version_needed();
+  // the central zip64 extra field holds only the values which overflow
+  if (zinfo.zip64()) {
+    this->extra_field_len = 4 +
+      (zinfo.uncompressed_size >= ZIP64_LIMIT ? 8 : 0) +
+      (zinfo.compressed_size >= ZIP64_LIMIT ? 8 : 0) +
+      (zinfo.header_offset >= ZIP64_LIMIT ? 8 : 0);
+    }
+  }
+
+end_of_central_directory::end_of_central_directory(std::uint64_t num_entries, std::uint64_t size, std::uint64_t offset) {
+  this->num_entries_disk = num_entries < ZIP64_LIMIT_ENTRIES ? num_entries : ZIP64_LIMIT_ENTRIES;
+  this->num_entries_total = this->num_entries_disk;
+  this->size = zip32(size);
+  this->offset = zip32(offset);
   }
 
-end_of_central_directory::end_of_central_directory(std::uint16_t num_entries, std::uint32_t size, std::uint32_t offset) {
+zip64_end_of_central_directory::zip64_end_of_central_directory(std::uint64_t num_entries, std::uint64_t size, std::uint64_t offset) {
   this->num_entries_disk = num_entries;
   this->num_entries_total = num_entries;
   this->size = size;
   this->offset = offset;
   }
 
-zip_file::zip_file(const std::string &arc_path, bool compress=true) {
+compression_policy::compression_policy(const std::string &name) {
+  // "fast" favours speed for scratch builds, "balanced" fast-deflates glifs
+  // and spends more effort on large plists, "best" favours ratio, and "zstd"
+  // uses zstandard (method 93) for archives read only by zstd-aware tools;
+  // without zstd support, "zstd" falls back to "balanced"
+  if (name == "fast") {
+    this->stored_size = 64;
+    this->glif_level = this->level = this->large_level = 1;
+    }
+  else if (name == "balanced") {
+    this->stored_size = 64;
+    this->large_size = 1 << 16;
+    this->glif_level = 1;
+    this->level = 6;
+    this->large_level = 9;
+    }
+  else if (name == "best")
+    this->glif_level = this->level = this->large_level = 9;
+  else if (name == "zstd") {
+#ifdef ZIP_ZSTD_SUPPORT
+    this->compression_method = ZIP_ZSTD;
+    this->stored_size = 64;
+    this->large_size = 1 << 16;
+    this->glif_level = 1;
+    this->level = 3;
+    this->large_level = 19;
+#else
+    *this = compression_policy("balanced");
+#endif
+    }
+  }
+std::uint16_t compression_policy::entry_compression_method(size_t size) const {
+  if (not size or size < this->stored_size)
+    return ZIP_STORED;
+  return this->compression_method;
+  }
+int compression_policy::entry_level(const std::string &arc_name, size_t size) const {
+  if (arc_name.size() > 5 and arc_name.compare(arc_name.size() - 5, 5, ".glif") == 0)
+    return this->glif_level;
+  if (this->large_size and size >= this->large_size)
+    return this->large_level;
+  return this->level;
+  }
+
+zip_entry::zip_entry(const std::string &arc_name, std::string_view data) {
+  this->arc_name = arc_name;
+  this->data = data;
+  }
+
+// reads the entries of the central directory of an archive, taking sizes and
+// offsets which overflow from their zip64 extra fields; encrypted entries are
+// left out. returns false when no valid end of central directory is found
+bool read_central_directory(std::istream &file, std::vector<zip_info> &zinfo_list) {
+  file.seekg(0, std::ios::end);
+  std::uint64_t file_size = file.tellg();
+  if (not file or file_size < ZIP_ECDR_SIZE)
+    return false;
+
+  // the end of central directory record is followed by a comment of at most
+  // 65535 bytes
+  size_t tail_size = std::min<std::uint64_t>(file_size, ZIP_ECDR_SIZE + 0xffff);
+  std::vector<char> tail(tail_size);
+  file.seekg(file_size - tail_size);
+  if (not file.read(tail.data(), tail_size))
+    return false;
+  size_t ecdr = tail_size - ZIP_ECDR_SIZE + 1;
+  do {
+    if (not ecdr--)
+      return false;
+    } while (field<std::uint32_t>(tail.data(), ecdr) != ZIP_ECDR_SIGNATURE);
+
+  std::uint64_t num_entries = field<std::uint16_t>(tail.data(), ecdr + 10);
+  std::uint64_t central_dir_size = field<std::uint32_t>(tail.data(), ecdr + 12);
+  std::uint64_t central_dir_offset = field<std::uint32_t>(tail.data(), ecdr + 16);
+  if (num_entries == ZIP64_LIMIT_ENTRIES or central_dir_size == ZIP64_LIMIT or central_dir_offset == ZIP64_LIMIT) {
+    std::uint64_t ecdr_offset = file_size - tail_size + ecdr;
+    char record[ZIP64_ECDR_SIZE];
+    if (ecdr_offset < ZIP64_ECDL_SIZE)
+      return false;
+    file.seekg(ecdr_offset - ZIP64_ECDL_SIZE);
+    if (not file.read(record, ZIP64_ECDL_SIZE) or field<std::uint32_t>(record, 0) != ZIP64_ECDL_SIGNATURE)
+      return false;
+    file.seekg(field<std::uint64_t>(record, 8));
+    if (not file.read(record, ZIP64_ECDR_SIZE) or field<std::uint32_t>(record, 0) != ZIP64_ECDR_SIGNATURE)
+      return false;
+    num_entries = field<std::uint64_t>(record, 32);
+    central_dir_size = field<std::uint64_t>(record, 40);
+    central_dir_offset = field<std::uint64_t>(record, 48);
+    }
+  if (central_dir_offset + central_dir_size > file_size)
+    return false;
+
+  std::vector<char> central_dir(central_dir_size);
+  file.seekg(central_dir_offset);
+  if (not file.read(central_dir.data(), central_dir_size))
+    return false;
+
+  zinfo_list.reserve(zinfo_list.size() + num_entries);
+  for (size_t pos = 0; num_entries--;) {
+    const char *cdh = central_dir.data() + pos;
+    if (pos + ZIP_CDH_SIZE > central_dir_size or field<std::uint32_t>(cdh, 0) != ZIP_CDH_SIGNATURE)
+      return false;
+    std::uint16_t file_name_len = field<std::uint16_t>(cdh, 28);
+    std::uint16_t extra_field_len = field<std::uint16_t>(cdh, 30);
+    std::uint16_t file_comment_len = field<std::uint16_t>(cdh, 32);
+    size_t next = pos + ZIP_CDH_SIZE + file_name_len + extra_field_len + file_comment_len;
+    if (next > central_dir_size)
+      return false;
+
+    zip_info zinfo(
+      std::string(cdh + ZIP_CDH_SIZE, file_name_len),
+      field<std::uint16_t>(cdh, 10),
+      field<std::uint16_t>(cdh, 12),
+      field<std::uint16_t>(cdh, 14),
+      field<std::uint32_t>(cdh, 24),
+      field<std::uint32_t>(cdh, 20),
+      field<std::uint32_t>(cdh, 16),
+      field<std::uint32_t>(cdh, 42)
+      );
+
+    // the zip64 extra field holds, in order, only the values which overflow
+    const char *extra = cdh + ZIP_CDH_SIZE + file_name_len;
+    for (size_t i = 0; i + 4 <= extra_field_len;) {
+      std::uint16_t id = field<std::uint16_t>(extra, i);
+      std::uint16_t size = field<std::uint16_t>(extra, i + 2);
+      if (i + 4 + size > extra_field_len)
+        break;
+      if (id == ZIP64_EXTRA_ID) {
+        size_t value = i + 4;
+        for (auto n : {&zinfo.uncompressed_size, &zinfo.compressed_size, &zinfo.header_offset})
+          if (*n == ZIP64_LIMIT and value + 8 <= i + 4 + size) {
+            *n = field<std::uint64_t>(extra, value);
+            value += 8;
+            }
+        }
+      i += 4 + size;
+      }
+
+    if (not (field<std::uint16_t>(cdh, 8) & ZIP_ENCRYPTED))
+      zinfo_list.push_back(std::move(zinfo));
+    pos = next;
+    }
+  return true;
+  }
+
+// offset of the payload of an entry, after its local file header, name and
+// extra field
+bool read_payload_offset(std::istream &file, const zip_info &zinfo, std::uint64_t &offset) {
+  char lfh[ZIP_LFH_SIZE];
+  file.seekg(zinfo.header_offset);
+  if (not file.read(lfh, ZIP_LFH_SIZE) or field<std::uint32_t>(lfh, 0) != ZIP_LFH_SIGNATURE)
+    return false;
+  offset = zinfo.header_offset + ZIP_LFH_SIZE + field<std::uint16_t>(lfh, 26) + field<std::uint16_t>(lfh, 28);
+  return true;
+  }
+
+zip_file::zip_file(const std::string &arc_path, bool compress, size_t memory_limit, const std::string &policy, bool update) {
   this->arc_path = arc_path;
-  this->compression_method = compress ? Z_DEFLATED : 0;
+  this->write_path = arc_path;
+  this->policy = compression_policy(policy);
+  if (not compress)
+    this->policy.compression_method = ZIP_STORED;
+  this->memory_limit = memory_limit;
   auto t = std::time(nullptr);
   auto dt = *std::localtime(&t);
   this->date = ((dt.tm_year - 80) << 9) + ((dt.tm_mon + 1) << 5) + dt.tm_mday;
   this->time = (dt.tm_hour << 11) + (dt.tm_min << 5) + (int(dt.tm_sec / 2));
-  this->archive.open(this->arc_path, std::ios::binary);
+  if (update)
+    this->read_previous();
+  this->archive.open(this->write_path, std::ios::binary);
+  }
+// a missing or unreadable archive is written in full
+void zip_file::read_previous() {
+  std::vector<zip_info> zinfo_list;
+  this->previous_archive.open(this->arc_path, std::ios::binary);
+  if (not this->previous_archive.is_open() or not read_central_directory(this->previous_archive, zinfo_list)) {
+    this->previous_archive.close();
+    return;
+    }
+  this->previous.reserve(zinfo_list.size());
+  for (auto &zinfo : zinfo_list) {
+    if (zinfo.compression_method != ZIP_STORED)
+      this->previous_compressed = true;
+    this->previous[zinfo.arc_name] = std::move(zinfo);
+    }
+  this->write_path = this->arc_path + ".tmp";
   }
 void zip_file::reserve(size_t n) {
+  this->entries.reserve(n);
   this->zinfo_list.reserve(n);
   }
-void zip_file::close() {
+void zip_file::add_entry(const std::string &arc_name, std::string data) {
+  // with a memory limit, pending entries are flushed to disk once their
+  // combined size reaches the limit; otherwise they are held until close
+  this->entries_size += data.size();
+  this->entries.emplace_back(arc_name, this->owned.emplace_back(std::move(data)));
+  if (this->memory_limit and this->entries_size >= this->memory_limit)
+    this->write_entries();
+  }
+void zip_file::write_entries() {
+  // entries are checksummed and compressed in parallel; the ordered region
+  // appends each finished entry in turn, so offsets are recorded in order.
+  // their data is released in bulk once the batch is written
+  // entries unchanged from a previous archive are copied raw instead, and
+  // compressed in turn only if their copy cannot be read
+  size_t n = this->entries.size();
+  #pragma omp parallel for ordered schedule(dynamic)
+  for (size_t i = 0; i < n; i++) {
+    auto &entry = this->entries[i];
+    std::string_view payload;
+    std::uint16_t compression_method = ZIP_STORED;
+    std::uint32_t crc = crc32_z(0, (const u_char*)entry.data.data(), entry.data.size());
+    const zip_info *previous = this->unchanged_entry(entry.arc_name, entry.data.size(), crc);
+    if (not previous)
+      compression_method = this->compress(entry.arc_name, entry.data, payload);
+    #pragma omp ordered
+    {
+      if (not previous or not this->copy_entry(*previous)) {
+        if (previous)
+          compression_method = this->compress(entry.arc_name, entry.data, payload);
+        this->write_entry(entry.arc_name, entry.data.size(), payload, compression_method, crc);
+        }
+      }
+    }
+  this->entries.clear();
+  this->entries_size = 0;
+  this->owned.clear();
+  this->arenas.release();
+  }
+// returns an error message, or an empty string on success; an updated
+// archive replaces the previous one only once it has been written in full
+std::string zip_file::close() {
   if (this->archive.is_open()) {
+    this->write_entries();
     this->finish();
     this->archive.close();
     }
+  bool written = not this->archive.fail();
+  if (not this->previous_archive.is_open())
+    return written ? std::string() : this->arc_path + ": the archive could not be written";
+
+  this->previous_archive.close();
+  if (not written) {
+    std::remove(this->write_path.c_str());
+    return this->arc_path + ": the archive could not be written";
+    }
+  if (not replace_file(this->write_path, this->arc_path)) {
+    std::string error = this->arc_path + ": " + std::strerror(errno);
+    std::remove(this->write_path.c_str());
+    return error;
+    }
+  return std::string();
+  }
+void zip_file::write_str(const std::string &arc_name, std::string_view data) {
+  std::uint32_t crc = crc32_z(0, (const u_char*)data.data(), data.size());
+  const zip_info *previous = this->unchanged_entry(arc_name, data.size(), crc);
+  if (previous and this->copy_entry(*previous))
+    return;
+  std::string_view payload;
+  std::uint16_t compression_method = this->compress(arc_name, data, payload);
+  this->write_entry(arc_name, data.size(), payload, compression_method, crc);
+  }
+// an entry of the previous archive is unchanged when its crc-32 and size match
+// and it was compressed with the method the policy now gives it, or stored
+// because it did not shrink when the previous archive was compressed; safe
+// to call from several threads
+const zip_info *zip_file::unchanged_entry(const std::string &arc_name, std::uint64_t size, std::uint32_t crc) const {
+  if (this->previous.empty())
+    return nullptr;
+  auto previous = this->previous.find(arc_name);
+  if (previous == this->previous.end())
+    return nullptr;
+  const auto &zinfo = previous->second;
+  std::uint16_t compression_method = this->policy.entry_compression_method(size);
+  bool stored = zinfo.compression_method == ZIP_STORED and
+    compression_method != ZIP_STORED and this->previous_compressed;
+  if (zinfo.crc != crc or zinfo.uncompressed_size != size or
+      (zinfo.compression_method != compression_method and not stored))
+    return nullptr;
+  return &zinfo;
+  }
+// copies the payload of an entry of the previous archive under a new local
+// file header, keeping its time and date; nothing is written if it cannot be
+// read
+bool zip_file::copy_entry(const zip_info &previous) {
+  std::uint64_t payload_offset;
+  if (not read_payload_offset(this->previous_archive, previous, payload_offset)) {
+    this->previous_archive.clear();
+    return false;
+    }
+  this->copy_buffer.resize(previous.compressed_size);
+  this->previous_archive.seekg(payload_offset);
+  if (not this->previous_archive.read(this->copy_buffer.data(), previous.compressed_size)) {
+    this->previous_archive.clear();
+    return false;
+    }
+
+  auto &zinfo = this->zinfo_list.emplace_back(previous);
+  zinfo.header_offset = this->tellp();
+  this->write_local_file_header(zinfo);
+  this->write(this->copy_buffer.data(), previous.compressed_size);
+  this->copied++;
+  return true;
   }
-void zip_file::write_str(const std::string &arc_name, const std::string &data) {
-  std::string compressed;
-  std::uint32_t crc = crc32_z(0, (const byte*)data.c_str(), data.size());
-  std::uint32_t header_offset = this->tellp();
+std::uint16_t zip_file::compress(const std::string &arc_name, std::string_view data, std::string_view &payload) {
+  // entries which do not shrink when compressed are stored; the payload view
+  // refers to the calling thread's compressor buffer until its next use
+  std::uint16_t compression_method = this->policy.entry_compression_method(data.size());
+  payload = data;
+  if (compression_method == ZIP_STORED)
+    return ZIP_STORED;
 
-  if (this->compression_method)
-    compressed = compress_str(data, this->compression_method);
+  auto &compressor = thread_compressor();
+  int level = this->policy.entry_level(arc_name, data.size());
+  size_t compressed_size = compression_method == ZIP_ZSTD ?
+    compressor.compress_zstd(data, level) : compressor.compress(data, level);
+  if (compressed_size >= data.size())
+    return ZIP_STORED;
+
+  payload = std::string_view((const char*)compressor.buffer.data(), compressed_size);
+  return compression_method;
+  }
+void zip_file::write_entry(
+    const std::string &arc_name,
+    std::uint64_t uncompressed_size,
+    std::string_view payload,
+    std::uint16_t compression_method,
+    std::uint32_t crc
+    ) {
+  std::uint64_t header_offset = this->tellp();
 
-  auto zinfo = this->zinfo_list.emplace_back(
+  const auto &zinfo = this->zinfo_list.emplace_back(
     arc_name,
-    this->compression_method,
+    compression_method,
     this->time,
     this->date,
-    data.size(),
-    compressed.size(),
+    uncompressed_size,
+    payload.size(),
     crc,
     header_offset
     );
 
   this->write_local_file_header(zinfo);
-  this->write(compressed.size() ? compressed : data);
+  this->write(payload.data(), payload.size());
   }
 void zip_file::write(const std::string &data) {
   this->archive.write(data.c_str(), data.size());
@@ -107,53 +496,123 @@ void zip_file::write(const std::string &data) {
 void zip_file::write(const char* data, size_t size) {
   this->archive.write(data, size);
   }
-std::uint32_t zip_file::tellp() {
-  return (std::uint32_t)this->archive.tellp();
+std::uint64_t zip_file::tellp() {
+  return (std::uint64_t)this->archive.tellp();
   }
 void zip_file::finish() {
-  std::uint32_t central_dir_offset = this->tellp();
+  std::uint64_t central_dir_offset = this->tellp();
   this->write_central_directory_header();
   this->write_end_of_central_directory_record(central_dir_offset);
   }
 void zip_file::write_local_file_header(const zip_info &zinfo) {
   zip::local_file_header local_file_header(zinfo);
-  this->write((const char*)&local_file_header, 30);
+  this->write((const char*)&local_file_header, ZIP_LFH_SIZE);
   this->write(zinfo.arc_name.c_str(), zinfo.arc_name.size());
+  if (local_file_header.extra_field_len) {
+    zip::zip64_extra_field_header extra_field_header(16);
+    this->write((const char*)&extra_field_header, 4);
+    this->write((const char*)&zinfo.uncompressed_size, 8);
+    this->write((const char*)&zinfo.compressed_size, 8);
+    }
   }
 void zip_file::write_central_directory_header() {
   zip::central_directory_header central_directory_header;
   for (const auto &zinfo : this->zinfo_list) {
     central_directory_header = zip::central_directory_header(zinfo);
-    this->write((const char*)&central_directory_header, 46);
+    this->write((const char*)&central_directory_header, ZIP_CDH_SIZE);
     this->write(zinfo.arc_name.c_str(), zinfo.arc_name.size());
+    if (central_directory_header.extra_field_len) {
+      zip::zip64_extra_field_header extra_field_header(central_directory_header.extra_field_len - 4);
+      this->write((const char*)&extra_field_header, 4);
+      if (zinfo.uncompressed_size >= ZIP64_LIMIT)
+        this->write((const char*)&zinfo.uncompressed_size, 8);
+      if (zinfo.compressed_size >= ZIP64_LIMIT)
+        this->write((const char*)&zinfo.compressed_size, 8);
+      if (zinfo.header_offset >= ZIP64_LIMIT)
+        this->write((const char*)&zinfo.header_offset, 8);
+      }
     }
   }
-void zip_file::write_end_of_central_directory_record(std::uint32_t central_dir_offset) {
+void zip_file::write_end_of_central_directory_record(std::uint64_t central_dir_offset) {
   size_t num_entries = this->zinfo_list.size();
-  std::uint32_t central_dir_size = this->tellp() - central_dir_offset;
+  std::uint64_t central_dir_end = this->tellp();
+  std::uint64_t central_dir_size = central_dir_end - central_dir_offset;
+
+  // a zip64 record and locator precede the end of central directory record
+  // when any of its values overflow; the overflowing fields are then set to
+  // their maximum value
+  if (num_entries >= ZIP64_LIMIT_ENTRIES or central_dir_size >= ZIP64_LIMIT or central_dir_offset >= ZIP64_LIMIT) {
+    zip::zip64_end_of_central_directory zip64_end_of_central_directory(num_entries, central_dir_size, central_dir_offset);
+    zip::zip64_end_of_central_directory_locator zip64_end_of_central_directory_locator(central_dir_end);
+    this->write((const char*)&zip64_end_of_central_directory, ZIP64_ECDR_SIZE);
+    this->write((const char*)&zip64_end_of_central_directory_locator, ZIP64_ECDL_SIZE);
+    }
+
   zip::end_of_central_directory end_of_central_directory(num_entries, central_dir_size, central_dir_offset);
-  this->write((const char*)&end_of_central_directory, 22);
+  this->write((const char*)&end_of_central_directory, ZIP_ECDR_SIZE);
   }
 
-std::string deflate_str(const std::string &data) {
-  z_stream stream;
-  std::vector<byte> out;
-  out.reserve(data.size() + 512);
-
-  stream.opaque = Z_NULL;
-  stream.zalloc = Z_NULL;
-  stream.zfree = Z_NULL;
-  stream.avail_in = data.size();
-  stream.next_in = (byte*)data.data();
-  stream.avail_out = data.size();
-  stream.next_out = out.data();
-
+compressor::compressor(int level) {
+  this->level = level;
+  this->stream.opaque = Z_NULL;
+  this->stream.zalloc = Z_NULL;
+  this->stream.zfree = Z_NULL;
   // provides a raw deflate (no zlib header and trailer)
-  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY);
-  deflate(&stream, Z_FINISH);
-  deflateEnd(&stream);
+  deflateInit2(&this->stream, level, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY);
+  }
+compressor::~compressor() {
+  deflateEnd(&this->stream);
+#ifdef ZIP_ZSTD_SUPPORT
+  ZSTD_freeCCtx(this->zstd_context);
+#endif
+  }
+size_t compressor::compress(std::string_view data, int level) {
+  deflateReset(&this->stream);
+  if (level != this->level) {
+    deflateParams(&this->stream, level, Z_DEFAULT_STRATEGY);
+    this->level = level;
+    }
+
+  size_t bound = deflateBound(&this->stream, data.size());
+  if (this->buffer.size() < bound)
+    this->buffer.resize(bound);
 
-  return std::string((const char*)out.data(), stream.total_out);
+  this->stream.avail_in = data.size();
+  this->stream.next_in = (u_char*)data.data();
+  this->stream.avail_out = this->buffer.size();
+  this->stream.next_out = this->buffer.data();
+
+  deflate(&this->stream, Z_FINISH);
+  return this->stream.total_out;
+  }
+size_t compressor::compress_zstd(std::string_view data, int level) {
+#ifdef ZIP_ZSTD_SUPPORT
+  if (this->zstd_context == nullptr)
+    this->zstd_context = ZSTD_createCCtx();
+
+  size_t bound = ZSTD_compressBound(data.size());
+  if (this->buffer.size() < bound)
+    this->buffer.resize(bound);
+
+  size_t compressed_size = ZSTD_compressCCtx(this->zstd_context,
+    this->buffer.data(), this->buffer.size(), data.data(), data.size(), level);
+  if (ZSTD_isError(compressed_size))
+    return data.size();
+  return compressed_size;
+#else
+  return this->compress(data, level);
+#endif
+  }
+
+compressor &thread_compressor() {
+  static thread_local compressor thread_compressor;
+  return thread_compressor;
+  }
+
+std::string deflate_str(const std::string &data) {
+  auto &compressor = thread_compressor();
+  size_t compressed_size = compressor.compress(data);
+  return std::string((const char*)compressor.buffer.data(), compressed_size);
   }
 
 std::string compress_str(const std::string &data, std::uint32_t compression_method) {
@@ -1,12 +1,14 @@
 // archive.hpp
 
 #pragma once
-#pragma pack(1)
 
 // https://pkware.cachefly.net/webdocs/casestudies/APPNOTE.TXT
 
 #define ZIP_STORED (0)
 #define ZIP_DEFLATED Z_DEFLATED
+#define ZIP_ZSTD (93)
+
+#define ZIP_ENCRYPTED (0x0001)
 
 #define ZIP_LFH_SIGNATURE (0x04034b50)
 #define ZIP_LFH_SIZE (30)
@@ -17,14 +19,30 @@
 #define ZIP_ECDR_SIGNATURE (0x06054b50)
 #define ZIP_ECDR_SIZE (22)
 
+#define ZIP64_ECDR_SIGNATURE (0x06064b50)
+#define ZIP64_ECDR_SIZE (56)
+
+#define ZIP64_ECDL_SIGNATURE (0x07064b50)
+#define ZIP64_ECDL_SIZE (20)
+
+#define ZIP64_EXTRA_ID (0x0001)
+#define ZIP64_LIMIT (0xffffffff)
+#define ZIP64_LIMIT_ENTRIES (0xffff)
+
+#define ZIP_VERSION (20)
+#define ZIP64_VERSION (45)
+#define ZIP_ZSTD_VERSION (63)
+
 typedef unsigned char u_char;
 
+namespace zip {
+
 struct zip_info {
   std::string arc_name;
-  std::uint32_t uncompressed_size;
-  std::uint32_t compressed_size;
+  std::uint64_t uncompressed_size;
+  std::uint64_t compressed_size;
   std::uint32_t crc;
-  std::uint32_t header_offset;
+  std::uint64_t header_offset;
   std::uint16_t compression_method;
   std::uint16_t time;
   std::uint16_t date;
@@ -34,16 +52,21 @@ struct zip_info {
     std::uint16_t compression_method,
     std::uint16_t time,
     std::uint16_t date,
-    std::uint32_t uncompressed_size,
-    std::uint32_t compressed_size,
+    std::uint64_t uncompressed_size,
+    std::uint64_t compressed_size,
     std::uint32_t crc,
-    std::uint32_t header_offset
+    std::uint64_t header_offset
     );
+  bool zip64_sizes() const;
+  bool zip64() const;
+  std::uint16_t version_needed() const;
   };
 
-struct zip_local_file_header {
+#pragma pack(push, 1)
+
+struct local_file_header {
   const std::uint32_t signature = ZIP_LFH_SIGNATURE;    // 4 local file header signature (0x04034b50)
-  const std::uint16_t version_needed = 20;              // 2 version needed to extract (minimum)
+  std::uint16_t version_needed = ZIP_VERSION;           // 2 version needed to extract (minimum)
   const std::uint16_t gp_bit_flag = 0;                  // 2 general purpose bit flag
   std::uint16_t compression_method;                     // 2 compression method
   std::uint16_t time;                                   // 2 last mod file time
@@ -52,14 +75,14 @@ struct zip_local_file_header {
   std::uint32_t compressed_size;                        // 4 compressed size
   std::uint32_t uncompressed_size;                      // 4 uncompressed size
   std::uint16_t arc_name_len;                           // 2 file name length
-  const std::uint16_t extra_field_len = 0;              // 2 extra field length
-  explicit zip_local_file_header(const zip_info &zinfo);
+  std::uint16_t extra_field_len = 0;                    // 2 extra field length
+  explicit local_file_header(const zip_info &zinfo);
   };
 
-struct zip_central_directory_header {
+struct central_directory_header {
   std::uint32_t signature = ZIP_CDH_SIGNATURE;          // 4 central file header signature (0x02014b50)
-  std::uint16_t version_made_by = 20;                   // 2 version made by
-  std::uint16_t version_needed = 20;                    // 2 version needed to extract
+  std::uint16_t version_made_by = ZIP_VERSION;          // 2 version made by
+  std::uint16_t version_needed = ZIP_VERSION;           // 2 version needed to extract
   std::uint16_t gp_bit_flag = 0;                        // 2 general purpose bit flag
   std::uint16_t compression_method;                     // 2 compression method
   std::uint16_t time;                                   // 2 file last mod time
@@ -74,11 +97,11 @@ struct zip_central_directory_header {
   std::uint16_t internal_file_attributes = 0;           // 2 internal file attributes
   std::uint32_t external_file_attributes = 0600 << 16;  // 4 external file attributes
   std::uint32_t relative_header_offset;                 // 4 relative offset of local header
-  zip_central_directory_header() {}
-  explicit zip_central_directory_header(const zip_info &zinfo);
+  central_directory_header() {}
+  explicit central_directory_header(const zip_info &zinfo);
   };
 
-struct zip_end_of_central_directory {
+struct end_of_central_directory {
   const std::uint32_t signature = ZIP_ECDR_SIGNATURE;   // 4 end of central dir signature (0x06054b50)
   const std::uint16_t disk_num = 0;                     // 2 number of this disk
   const std::uint16_t disk_num_start = 0;               // 2 number of the disk with the start of the central directory
@@ -87,5 +110,137 @@ struct zip_end_of_central_directory {
   std::uint32_t size;                                   // 4 size of central directory
   std::uint32_t offset;                                 // 4 offset of start of central directory with respect to the starting disk number
   const std::uint16_t comment_len = 0;                  // 2 .ZIP file comment length
-  zip_end_of_central_directory(std::uint16_t num_entries, std::uint32_t size, std::uint32_t offset);
+  end_of_central_directory(std::uint64_t num_entries, std::uint64_t size, std::uint64_t offset);
+  };
+
+struct zip64_extra_field_header {
+  const std::uint16_t id = ZIP64_EXTRA_ID;              // 2 zip64 extended information extra field tag (0x0001)
+  std::uint16_t size;                                   // 2 size of this "extra" block
+  explicit zip64_extra_field_header(std::uint16_t size) : size(size) {}
+  };
+
+struct zip64_end_of_central_directory {
+  const std::uint32_t signature = ZIP64_ECDR_SIGNATURE; // 4 zip64 end of central dir signature (0x06064b50)
+  const std::uint64_t record_size = ZIP64_ECDR_SIZE - 12; // 8 size of zip64 end of central directory record
+  const std::uint16_t version_made_by = ZIP64_VERSION;  // 2 version made by
+  const std::uint16_t version_needed = ZIP64_VERSION;   // 2 version needed to extract
+  const std::uint32_t disk_num = 0;                     // 4 number of this disk
+  const std::uint32_t disk_num_start = 0;               // 4 number of the disk with the start of the central directory
+  std::uint64_t num_entries_disk;                       // 8 total number of entries in the central directory on this disk
+  std::uint64_t num_entries_total;                      // 8 total number of entries in the central directory
+  std::uint64_t size;                                   // 8 size of the central directory
+  std::uint64_t offset;                                 // 8 offset of start of central directory with respect to the starting disk number
+  zip64_end_of_central_directory(std::uint64_t num_entries, std::uint64_t size, std::uint64_t offset);
+  };
+
+struct zip64_end_of_central_directory_locator {
+  const std::uint32_t signature = ZIP64_ECDL_SIGNATURE; // 4 zip64 end of central dir locator signature (0x07064b50)
+  const std::uint32_t disk_num_start = 0;               // 4 number of the disk with the start of the zip64 end of central directory
+  std::uint64_t offset;                                 // 8 relative offset of the zip64 end of central directory record
+  const std::uint32_t disk_total = 1;                   // 4 total number of disks
+  explicit zip64_end_of_central_directory_locator(std::uint64_t offset) : offset(offset) {}
+  };
+
+#pragma pack(pop)
+
+// per-entry compression settings: entries smaller than stored_size are
+// stored, .glif entries use glif_level, and all other entries use level, or
+// large_level once they reach large_size
+struct compression_policy {
+  std::uint16_t compression_method = ZIP_DEFLATED;
+  size_t stored_size = 0;
+  size_t large_size = 0;
+  int glif_level = Z_DEFAULT_COMPRESSION;
+  int level = Z_DEFAULT_COMPRESSION;
+  int large_level = Z_DEFAULT_COMPRESSION;
+  compression_policy() {}
+  explicit compression_policy(const std::string &name);
+  std::uint16_t entry_compression_method(size_t size) const;
+  int entry_level(const std::string &arc_name, size_t size) const;
+  };
+
+// archive member held in memory until the archive is written; data is owned
+// by the zip_file or by the arena the member was rendered into
+struct zip_entry {
+  std::string arc_name;
+  std::string_view data;
+  zip_entry() {}
+  zip_entry(const std::string &arc_name, std::string_view data);
+  };
+
+bool read_central_directory(std::istream &file, std::vector<zip_info> &zinfo_list);
+bool read_payload_offset(std::istream &file, const zip_info &zinfo, std::uint64_t &offset);
+
+// with update set, entries of an existing archive at arc_path whose crc-32,
+// size and compression method are unchanged are copied raw from it to a new
+// archive written beside it, which then replaces it on close; the previous
+// archive is kept as it was when the update cannot be completed
+class zip_file {
+  public:
+  std::string arc_path;
+  std::string write_path;
+  std::vector<zip_entry> entries;
+  std::vector<zip_info> zinfo_list;
+  arena_pool arenas;
+  std::ofstream archive;
+  compression_policy policy;
+  std::uint16_t time;
+  std::uint16_t date;
+  size_t memory_limit;
+  size_t entries_size = 0;
+  size_t copied = 0;
+  zip_file(const std::string &arc_path, bool compress=true, size_t memory_limit=0, const std::string &policy="", bool update=false);
+  void reserve(size_t n);
+  void add_entry(const std::string &arc_name, std::string data);
+  void write_entries();
+  void write_str(const std::string &arc_name, std::string_view data);
+  void write_entry(
+    const std::string &arc_name,
+    std::uint64_t uncompressed_size,
+    std::string_view payload,
+    std::uint16_t compression_method,
+    std::uint32_t crc
+    );
+  void write(const std::string &data);
+  void write(const char* data, size_t size);
+  std::uint64_t tellp();
+  std::string close();
+  private:
+  std::deque<std::string> owned;
+  std::ifstream previous_archive;
+  std::unordered_map<std::string, zip_info> previous;
+  bool previous_compressed = false;
+  std::vector<char> copy_buffer;
+  void read_previous();
+  const zip_info *unchanged_entry(const std::string &arc_name, std::uint64_t size, std::uint32_t crc) const;
+  bool copy_entry(const zip_info &previous);
+  std::uint16_t compress(const std::string &arc_name, std::string_view data, std::string_view &payload);
+  void finish();
+  void write_local_file_header(const zip_info &zinfo);
+  void write_central_directory_header();
+  void write_end_of_central_directory_record(std::uint64_t central_dir_offset);
   };
+
+// raw deflate stream reset and reused for each entry compressed on a thread
+class compressor {
+  public:
+  z_stream stream;
+  int level;
+  std::vector<u_char> buffer;
+#ifdef ZIP_ZSTD_SUPPORT
+  ZSTD_CCtx* zstd_context = nullptr;
+#endif
+  compressor(int level=Z_DEFAULT_COMPRESSION);
+  ~compressor();
+  compressor(const compressor&) = delete;
+  compressor &operator=(const compressor&) = delete;
+  size_t compress(std::string_view data, int level=Z_DEFAULT_COMPRESSION);
+  size_t compress_zstd(std::string_view data, int level);
+  };
+
+compressor &thread_compressor();
+std::string deflate_str(const std::string &data);
+std::string compress_str(const std::string &data, std::uint32_t compression_method);
+void write_archive(const std::string &filename, std::unordered_map<std::string, std::string> &files, bool compress);
+
+} // namespace zip
@@ -0,0 +1,119 @@
+// arena.cpp
+
+#pragma once
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+#include <omp.h>
+
+// size of the first block of each arena; later blocks grow geometrically
+#define ARENA_BLOCK_SIZE (1 << 20)
+
+// inline storage of an arena_buffer; kept to a single byte so that anything
+// rendered into it is allocated from the arena
+#define ARENA_INLINE_SIZE (1)
+
+// allocator on an arena whose memory belongs to the arena, not to the
+// container that asked for it: deallocate gives nothing back, and all of it
+// is freed together when the arena is released, so what a container
+// allocated stays valid after the container is gone
+template <typename T>
+struct arena_allocator {
+  using value_type = T;
+  std::pmr::monotonic_buffer_resource *arena;
+  arena_allocator(std::pmr::monotonic_buffer_resource *arena) : arena(arena) {}
+  template <typename U>
+  arena_allocator(const arena_allocator<U> &other) : arena(other.arena) {}
+  T *allocate(size_t n) {
+    return (T*) this->arena->allocate(n * sizeof(T), alignof(T));
+    }
+  void deallocate(T*, size_t) {}
+  bool operator==(const arena_allocator &other) const {
+    return this->arena == other.arena;
+    }
+  };
+
+// buffer that allocates from an arena, so what is rendered into it can be
+// handed out as a view without a copy; memory it gives up as it grows is
+// only reclaimed when the arena is released
+using arena_buffer = fmt::basic_memory_buffer<char, ARENA_INLINE_SIZE, arena_allocator<char>>;
+
+// index of the calling thread among all threads that have used an arena
+// pool, assigned on first use; unlike omp_get_thread_num(), which numbers
+// threads only within the innermost team, no two threads share an index
+static inline size_t arena_thread() {
+  static std::atomic<size_t> threads = 0;
+  thread_local size_t index = threads++;
+  return index;
+  }
+
+// one monotonic arena per thread that rendered files are stored in until
+// they are written
+//
+// a thread renders only into its own arena, so rendering takes no lock and
+// costs an allocation only when the arena needs a new block; threads beyond
+// those the pool was sized for, such as those of nested teams, store into a
+// shared arena under a lock. the views returned stay valid until release(),
+// which frees every arena at once
+class arena_pool {
+  public:
+  arena_pool();
+  std::string_view render(auto repr);
+  std::string_view store(std::string_view data);
+  void release();
+  private:
+  std::vector<std::unique_ptr<std::pmr::monotonic_buffer_resource>> arenas;
+  std::pmr::monotonic_buffer_resource shared;
+  };
+
+arena_pool::arena_pool() {
+  this->arenas.resize(omp_get_max_threads());
+  for (auto &arena : this->arenas)
+    arena = std::make_unique<std::pmr::monotonic_buffer_resource>(ARENA_BLOCK_SIZE);
+  }
+
+// calls repr with a buffer on the calling thread's arena and returns a view
+// of what it rendered, which the arena owns
+std::string_view arena_pool::render(auto repr) {
+  size_t thread = arena_thread();
+  if (thread >= this->arenas.size()) {
+    fmt::memory_buffer buf;
+    repr(buf);
+    return this->store(std::string_view(buf.data(), buf.size()));
+    }
+  arena_buffer buf{arena_allocator<char>(this->arenas[thread].get())};
+  repr(buf);
+  // nothing beyond the inline storage was needed, so the buffer holds it
+  if (buf.capacity() <= ARENA_INLINE_SIZE)
+    return this->store(std::string_view(buf.data(), buf.size()));
+  return std::string_view(buf.data(), buf.size());
+  }
+
+std::string_view arena_pool::store(std::string_view data) {
+  if (data.empty())
+    return std::string_view();
+  char *stored;
+  size_t thread = arena_thread();
+  if (thread < this->arenas.size())
+    stored = (char*) this->arenas[thread]->allocate(data.size(), 1);
+  else {
+    #pragma omp critical(arena_pool)
+    stored = (char*) this->shared.allocate(data.size(), 1);
+    }
+  std::memcpy(stored, data.data(), data.size());
+  return std::string_view(stored, data.size());
+  }
+
+void arena_pool::release() {
+  for (auto &arena : this->arenas)
+    arena->release();
+  this->shared.release();
+  }
@@ -0,0 +1,461 @@
+// dump.cpp
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "dump.hpp"
+#include "output.cpp"
+
+// builds a dump one glyph at a time; the elements of a glyph are added after
+// it, vertical hints before horizontal ones, and each coordinate is given as
+// one value per master
+class dump_writer {
+  public:
+  dump_writer(size_t axes, size_t upm, const std::string &family_name);
+  void add_glyph(
+    size_t index,
+    const std::string &name,
+    const std::string &glif_name,
+    int mark,
+    const std::vector<long> &code_points,
+    bool omit,
+    bool base,
+    bool hints,
+    const std::vector<float> &width
+    );
+  void add_contour();
+  void add_point(const std::vector<float> &x, const std::vector<float> &y, int type=0, int alignment=0, int hintset=DUMP_NO_HINTSET);
+  void set_point(const std::vector<float> &x, const std::vector<float> &y, int type, int alignment, int hintset=DUMP_NO_HINTSET);
+  void add_component(
+    const std::string &base,
+    size_t index,
+    const std::vector<float> &offset_x,
+    const std::vector<float> &offset_y,
+    const std::vector<float> &scale_x,
+    const std::vector<float> &scale_y
+    );
+  void add_anchor(const std::string &name, const std::vector<float> &x, const std::vector<float> &y);
+  void add_hint(const std::vector<float> &position, const std::vector<float> &width, bool vertical, bool ghost);
+  void add_replacement(int type, size_t index);
+  void add_kern_pair(size_t first, size_t second, const std::vector<float> &value);
+  std::string data() const;
+  int write(const std::string &path) const;
+  private:
+  dump_header header;
+  std::vector<dump_glyph> glyphs;
+  std::vector<std::uint32_t> code_points;
+  std::vector<dump_range> contours;
+  std::vector<dump_point> points;
+  std::vector<dump_component> components;
+  std::vector<dump_anchor> anchors;
+  std::vector<dump_hint> hints;
+  std::vector<dump_replacement> replacements;
+  std::vector<dump_kern_pair> kerning;
+  std::vector<float> values;
+  std::string strings;
+  dump_string add_string(const std::string &str);
+  std::uint32_t add_values(const std::vector<float> &values);
+  void set_values(std::uint32_t offset, const std::vector<float> &values);
+  void set_point(dump_point &point, const std::vector<float> &x, const std::vector<float> &y, int type, int alignment, int hintset);
+  };
+
+dump_writer::dump_writer(size_t axes, size_t upm, const std::string &family_name) {
+  this->header.axes = axes;
+  this->header.masters = 1 << axes;
+  this->header.upm = upm;
+  this->header.family_name = this->add_string(family_name);
+  }
+
+dump_string dump_writer::add_string(const std::string &str) {
+  dump_string ref;
+  ref.offset = this->strings.size();
+  ref.size = str.size();
+  this->strings += str;
+  return ref;
+  }
+
+// stores one value per master at offset, repeating the last value given for
+// any missing masters
+void dump_writer::set_values(std::uint32_t offset, const std::vector<float> &values) {
+  for (size_t i = 0; i < this->header.masters; i++)
+    this->values[offset + i] = values.empty() ? 0.0f : values[std::min(i, values.size() - 1)];
+  }
+
+std::uint32_t dump_writer::add_values(const std::vector<float> &values) {
+  std::uint32_t offset = this->values.size();
+  this->values.resize(offset + this->header.masters);
+  this->set_values(offset, values);
+  return offset;
+  }
+
+void dump_writer::add_glyph(
+    size_t index,
+    const std::string &name,
+    const std::string &glif_name,
+    int mark,
+    const std::vector<long> &code_points,
+    bool omit,
+    bool base,
+    bool hints,
+    const std::vector<float> &width
+    ) {
+  dump_glyph glyph;
+  glyph.index = index;
+  glyph.mark = mark;
+  glyph.name = this->add_string(name);
+  glyph.glif_name = this->add_string(glif_name);
+  glyph.width = this->add_values(width);
+  glyph.omit = omit;
+  glyph.base = base;
+  glyph.hints = hints;
+  glyph.code_points.start = this->code_points.size();
+  for (const auto &code_point : code_points)
+    this->code_points.push_back(code_point);
+  glyph.code_points.end = this->code_points.size();
+  glyph.contours.start = glyph.contours.end = this->contours.size();
+  glyph.components.start = glyph.components.end = this->components.size();
+  glyph.anchors.start = glyph.anchors.end = this->anchors.size();
+  glyph.vhints.start = glyph.vhints.end = this->hints.size();
+  glyph.hhints.start = glyph.hhints.end = this->hints.size();
+  glyph.replacements.start = glyph.replacements.end = this->replacements.size();
+  this->glyphs.push_back(glyph);
+  }
+
+void dump_writer::add_contour() {
+  dump_range contour;
+  contour.start = contour.end = this->points.size();
+  this->contours.push_back(contour);
+  this->glyphs.back().contours.end = this->contours.size();
+  }
+
+void dump_writer::set_point(dump_point &point, const std::vector<float> &x, const std::vector<float> &y, int type, int alignment, int hintset) {
+  this->set_values(point.values, x);
+  this->set_values(point.values + this->header.masters, y);
+  point.hintset = hintset;
+  point.type = type;
+  point.smooth = alignment > 0;
+  }
+
+void dump_writer::add_point(const std::vector<float> &x, const std::vector<float> &y, int type, int alignment, int hintset) {
+  dump_point point;
+  point.values = this->values.size();
+  this->values.resize(point.values + 2 * this->header.masters);
+  this->set_point(point, x, y, type, alignment, hintset);
+  this->points.push_back(point);
+  this->contours.back().end = this->points.size();
+  }
+
+// replaces the first point of the current contour, as a closing curve does;
+// the point keeps its hint set unless given a new one
+void dump_writer::set_point(const std::vector<float> &x, const std::vector<float> &y, int type, int alignment, int hintset) {
+  auto &point = this->points[this->contours.back().start];
+  this->set_point(point, x, y, type, alignment, hintset == DUMP_NO_HINTSET ? point.hintset : hintset);
+  }
+
+void dump_writer::add_component(
+    const std::string &base,
+    size_t index,
+    const std::vector<float> &offset_x,
+    const std::vector<float> &offset_y,
+    const std::vector<float> &scale_x,
+    const std::vector<float> &scale_y
+    ) {
+  dump_component component;
+  component.base = this->add_string(base);
+  component.index = index;
+  component.values = this->add_values(offset_x);
+  this->add_values(offset_y);
+  this->add_values(scale_x);
+  this->add_values(scale_y);
+  this->components.push_back(component);
+  this->glyphs.back().components.end = this->components.size();
+  }
+
+void dump_writer::add_anchor(const std::string &name, const std::vector<float> &x, const std::vector<float> &y) {
+  dump_anchor anchor;
+  anchor.name = this->add_string(name);
+  anchor.values = this->add_values(x);
+  this->add_values(y);
+  this->anchors.push_back(anchor);
+  this->glyphs.back().anchors.end = this->anchors.size();
+  }
+
+void dump_writer::add_hint(const std::vector<float> &position, const std::vector<float> &width, bool vertical, bool ghost) {
+  dump_hint hint;
+  hint.values = this->add_values(position);
+  this->add_values(width);
+  hint.vertical = vertical;
+  hint.ghost = ghost;
+  this->hints.push_back(hint);
+  auto &glyph = this->glyphs.back();
+  if (vertical)
+    glyph.vhints.end = glyph.hhints.start = glyph.hhints.end = this->hints.size();
+  else
+    glyph.hhints.end = this->hints.size();
+  }
+
+void dump_writer::add_replacement(int type, size_t index) {
+  dump_replacement replacement;
+  replacement.type = type;
+  replacement.index = index;
+  this->replacements.push_back(replacement);
+  this->glyphs.back().replacements.end = this->replacements.size();
+  }
+
+// kerning pairs are independent of the glyphs and may be added at any time
+void dump_writer::add_kern_pair(size_t first, size_t second, const std::vector<float> &value) {
+  dump_kern_pair pair;
+  pair.first = first;
+  pair.second = second;
+  pair.values = this->add_values(value);
+  this->kerning.push_back(pair);
+  }
+
+// lays the sections out after the header
+std::string dump_writer::data() const {
+  dump_header header = this->header;
+  std::string data(sizeof(dump_header), '\0');
+
+  auto add_section = [&](dump_section_id id, const auto &records) {
+    data.resize((data.size() + DUMP_ALIGNMENT - 1) / DUMP_ALIGNMENT * DUMP_ALIGNMENT, '\0');
+    header.sections[id].offset = data.size();
+    header.sections[id].count = std::size(records);
+    data.append((const char*) std::data(records), std::size(records) * sizeof(*std::data(records)));
+    };
+
+  add_section(DUMP_GLYPHS, this->glyphs);
+  add_section(DUMP_CODE_POINTS, this->code_points);
+  add_section(DUMP_CONTOURS, this->contours);
+  add_section(DUMP_POINTS, this->points);
+  add_section(DUMP_COMPONENTS, this->components);
+  add_section(DUMP_ANCHORS, this->anchors);
+  add_section(DUMP_HINTS, this->hints);
+  add_section(DUMP_REPLACEMENTS, this->replacements);
+  add_section(DUMP_KERNING, this->kerning);
+  add_section(DUMP_VALUES, this->values);
+  add_section(DUMP_STRINGS, this->strings);
+
+  std::memcpy(data.data(), &header, sizeof(dump_header));
+  return data;
+  }
+
+// writes the dump in one go; returns errno, or 0 on success
+int dump_writer::write(const std::string &path) const {
+  return write_output_file(path, this->data());
+  }
+
+
+// read-only view of a dump, memory-mapped where the platform allows and read
+// into memory otherwise, or taken over from dump_writer::data(); every range
+// and offset is checked once on opening so the records can be used without
+// further checks
+class dump_reader {
+  public:
+  const dump_header *header = nullptr;
+  dump_reader() {}
+  ~dump_reader();
+  dump_reader(const dump_reader&) = delete;
+  dump_reader &operator=(const dump_reader&) = delete;
+  std::string open(const std::string &path);
+  std::string load(std::string data);
+  template<typename T> const T *records(dump_section_id id) const;
+  size_t count(dump_section_id id) const;
+  const float *values(std::uint32_t offset) const;
+  std::string_view str(const dump_string &ref) const;
+  private:
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  std::string buffer;
+  std::string validate();
+  std::string check() const;
+  };
+
+dump_reader::~dump_reader() {
+#ifndef _WIN32
+  if (this->mapped)
+    ::munmap((void*) this->data, this->size);
+#endif
+  }
+
+// maps or reads the dump at path; returns an error message, or an empty
+// string on success
+std::string dump_reader::open(const std::string &path) {
+#ifdef _WIN32
+  std::ifstream file(path, std::ios::binary);
+  if (not file)
+    return path + ": " + std::strerror(errno);
+  this->buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  this->data = this->buffer.data();
+  this->size = this->buffer.size();
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return path + ": " + std::strerror(errno);
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    int error = errno;
+    ::close(fd);
+    return path + ": " + std::strerror(error);
+    }
+  this->size = st.st_size;
+  if (this->size) {
+    void *data = ::mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      int error = errno;
+      ::close(fd);
+      return path + ": " + std::strerror(error);
+      }
+    this->data = (const char*) data;
+    this->mapped = true;
+    }
+  ::close(fd);
+#endif
+
+  std::string error = this->validate();
+  return error.empty() ? error : path + ": " + error;
+  }
+
+// takes over a dump held in memory; returns an error message, or an empty
+// string on success
+std::string dump_reader::load(std::string data) {
+  this->buffer = std::move(data);
+  this->data = this->buffer.data();
+  this->size = this->buffer.size();
+  return this->validate();
+  }
+
+std::string dump_reader::validate() {
+  if (this->size < sizeof(dump_header))
+    return "not a glyph dump";
+  this->header = (const dump_header*) this->data;
+  std::string error = this->check();
+  if (not error.empty())
+    this->header = nullptr;
+  return error;
+  }
+
+template<typename T>
+const T *dump_reader::records(dump_section_id id) const {
+  return (const T*) (this->data + this->header->sections[id].offset);
+  }
+
+size_t dump_reader::count(dump_section_id id) const {
+  return this->header->sections[id].count;
+  }
+
+const float *dump_reader::values(std::uint32_t offset) const {
+  return this->records<float>(DUMP_VALUES) + offset;
+  }
+
+std::string_view dump_reader::str(const dump_string &ref) const {
+  return std::string_view(this->records<char>(DUMP_STRINGS) + ref.offset, ref.size);
+  }
+
+std::string dump_reader::check() const {
+  const auto &header = *this->header;
+  if (header.magic != DUMP_MAGIC)
+    return "not a glyph dump";
+  if (header.version != DUMP_VERSION)
+    return "unsupported glyph dump version " + std::to_string(header.version);
+  if (header.axes > DUMP_MAX_AXES or header.masters != 1u << header.axes)
+    return "invalid glyph dump master count";
+
+  static const size_t sizes[DUMP_SECTIONS] = {
+    sizeof(dump_glyph),
+    sizeof(std::uint32_t),
+    sizeof(dump_range),
+    sizeof(dump_point),
+    sizeof(dump_component),
+    sizeof(dump_anchor),
+    sizeof(dump_hint),
+    sizeof(dump_replacement),
+    sizeof(dump_kern_pair),
+    sizeof(float),
+    sizeof(char),
+    };
+  for (size_t id = 0; id < DUMP_SECTIONS; id++) {
+    const auto &section = header.sections[id];
+    if (section.offset % DUMP_ALIGNMENT or section.offset > this->size or
+        section.count > (this->size - section.offset) / sizes[id])
+      return "glyph dump section " + std::to_string(id) + " out of bounds";
+    }
+
+  size_t masters = header.masters;
+  auto range_ok = [&](const dump_range &range, dump_section_id id) {
+    return range.start <= range.end and range.end <= this->count(id);
+    };
+  auto string_ok = [&](const dump_string &ref) {
+    return (size_t) ref.offset + ref.size <= this->count(DUMP_STRINGS);
+    };
+  auto values_ok = [&](std::uint32_t offset, size_t n) {
+    return (size_t) offset + n * masters <= this->count(DUMP_VALUES);
+    };
+
+  if (not string_ok(header.family_name))
+    return "glyph dump family name out of bounds";
+
+  const auto *contours = this->records<dump_range>(DUMP_CONTOURS);
+  for (size_t i = 0; i < this->count(DUMP_CONTOURS); i++)
+    if (not range_ok(contours[i], DUMP_POINTS))
+      return "glyph dump contour " + std::to_string(i) + " out of bounds";
+
+  const auto *points = this->records<dump_point>(DUMP_POINTS);
+  for (size_t i = 0; i < this->count(DUMP_POINTS); i++)
+    if (not values_ok(points[i].values, 2) or points[i].type > 3)
+      return "glyph dump point " + std::to_string(i) + " out of bounds";
+
+  const auto *components = this->records<dump_component>(DUMP_COMPONENTS);
+  for (size_t i = 0; i < this->count(DUMP_COMPONENTS); i++)
+    if (not string_ok(components[i].base) or not values_ok(components[i].values, 4))
+      return "glyph dump component " + std::to_string(i) + " out of bounds";
+
+  const auto *anchors = this->records<dump_anchor>(DUMP_ANCHORS);
+  for (size_t i = 0; i < this->count(DUMP_ANCHORS); i++)
+    if (not string_ok(anchors[i].name) or not values_ok(anchors[i].values, 2))
+      return "glyph dump anchor " + std::to_string(i) + " out of bounds";
+
+  const auto *hints = this->records<dump_hint>(DUMP_HINTS);
+  for (size_t i = 0; i < this->count(DUMP_HINTS); i++)
+    if (not values_ok(hints[i].values, 2))
+      return "glyph dump hint " + std::to_string(i) + " out of bounds";
+
+  const auto *kerning = this->records<dump_kern_pair>(DUMP_KERNING);
+  for (size_t i = 0; i < this->count(DUMP_KERNING); i++)
+    if (not values_ok(kerning[i].values, 1))
+      return "glyph dump kerning pair " + std::to_string(i) + " out of bounds";
+
+  const auto *glyphs = this->records<dump_glyph>(DUMP_GLYPHS);
+  for (size_t i = 0; i < this->count(DUMP_GLYPHS); i++) {
+    const auto &glyph = glyphs[i];
+    if (not string_ok(glyph.name) or not string_ok(glyph.glif_name) or
+        not values_ok(glyph.width, 1) or
+        not range_ok(glyph.code_points, DUMP_CODE_POINTS) or
+        not range_ok(glyph.contours, DUMP_CONTOURS) or
+        not range_ok(glyph.components, DUMP_COMPONENTS) or
+        not range_ok(glyph.anchors, DUMP_ANCHORS) or
+        not range_ok(glyph.vhints, DUMP_HINTS) or
+        not range_ok(glyph.hhints, DUMP_HINTS) or
+        not range_ok(glyph.replacements, DUMP_REPLACEMENTS) or
+        glyph.mark < 0 or glyph.mark > 255)
+      return "glyph dump glyph " + std::to_string(i) + " out of bounds";
+    }
+  return "";
+  }
@@ -0,0 +1,125 @@
+// dump.hpp
+
+#pragma once
+
+// binary glyph dump
+//
+// written once from FontLab by dump.pyx and memory-mapped by the headless
+// converter (headless.cpp), or handed to cpp_instances in memory; holds every
+// glyph and kerning pair of a font with its values for each master, so
+// instances can be built without FontLab
+//
+// a dump_header is followed by the sections it lists, each an array of
+// fixed-size records starting on an 8-byte boundary; ranges index the
+// records of another section, and a values field is the offset in the values
+// section of one run of floats per master for each stored coordinate, in the
+// order listed for the record. all fields are little-endian
+
+#define DUMP_MAGIC (0x44424656)  // "VFBD"
+#define DUMP_VERSION (2)
+#define DUMP_MAX_AXES (4)
+#define DUMP_ALIGNMENT (8)
+#define DUMP_NO_HINTSET (-1)
+
+enum dump_section_id {
+  DUMP_GLYPHS,        // dump_glyph
+  DUMP_CODE_POINTS,   // std::uint32_t
+  DUMP_CONTOURS,      // dump_range of points
+  DUMP_POINTS,        // dump_point
+  DUMP_COMPONENTS,    // dump_component
+  DUMP_ANCHORS,       // dump_anchor
+  DUMP_HINTS,         // dump_hint
+  DUMP_REPLACEMENTS,  // dump_replacement
+  DUMP_KERNING,       // dump_kern_pair
+  DUMP_VALUES,        // float
+  DUMP_STRINGS,       // char
+  DUMP_SECTIONS,
+  };
+
+#pragma pack(push, 1)
+
+struct dump_section {
+  std::uint64_t offset = 0;                 // 8 offset of the first record from the start of the file
+  std::uint64_t count = 0;                  // 8 number of records
+  };
+
+struct dump_range {
+  std::uint32_t start = 0;                  // 4 first record
+  std::uint32_t end = 0;                    // 4 one past the last record
+  };
+
+struct dump_string {
+  std::uint32_t offset = 0;                 // 4 offset in the strings section
+  std::uint32_t size = 0;                   // 4 length in bytes, utf-8
+  };
+
+struct dump_header {
+  std::uint32_t magic = DUMP_MAGIC;         // 4 "VFBD"
+  std::uint32_t version = DUMP_VERSION;     // 4 format version
+  std::uint32_t axes = 0;                   // 4 number of axes
+  std::uint32_t masters = 1;                // 4 number of masters (2 ** axes)
+  std::uint32_t upm = 1000;                 // 4 units per em of the font
+  std::uint32_t reserved = 0;               // 4
+  dump_string family_name;                  // 8 font family name
+  dump_section sections[DUMP_SECTIONS];     // 176 section table, by dump_section_id
+  };
+
+struct dump_glyph {
+  std::uint32_t index = 0;                  // 4 glyph index in the font
+  std::int32_t mark = 0;                    // 4 mark color index
+  dump_string name;                         // 8 glyph name
+  dump_string glif_name;                    // 8 .glif file name
+  std::uint32_t width = 0;                  // 4 values: advance width
+  std::uint8_t omit = 0;                    // 1 glyph is omitted from the UFO
+  std::uint8_t base = 0;                    // 1 glyph is a component base
+  std::uint8_t hints = 0;                   // 1 glyph is hinted; points carry hint sets
+  std::uint8_t reserved = 0;                // 1
+  dump_range code_points;                   // 8 code points
+  dump_range contours;                      // 8 contours
+  dump_range components;                    // 8 components
+  dump_range anchors;                       // 8 anchors
+  dump_range vhints;                        // 8 vertical hints
+  dump_range hhints;                        // 8 horizontal hints
+  dump_range replacements;                  // 8 hint replacement table
+  };
+
+struct dump_point {
+  std::uint32_t values = 0;                 // 4 values: x, y
+  std::int32_t hintset = DUMP_NO_HINTSET;   // 4 hint set started by this point
+  std::uint8_t type = 0;                    // 1 POINT_TYPES index
+  std::uint8_t smooth = 0;                  // 1 smooth point
+  std::uint8_t reserved[2] = {0, 0};        // 2
+  };
+
+struct dump_component {
+  dump_string base;                         // 8 base glyph name
+  std::uint32_t index = 0;                  // 4 base glyph index in the font
+  std::uint32_t values = 0;                 // 4 values: x offset, y offset, x scale, y scale
+  };
+
+struct dump_anchor {
+  dump_string name;                         // 8 anchor name
+  std::uint32_t values = 0;                 // 4 values: x, y
+  std::uint32_t reserved = 0;               // 4
+  };
+
+struct dump_hint {
+  std::uint32_t values = 0;                 // 4 values: position, width
+  std::uint8_t vertical = 0;                // 1 vertical stem
+  std::uint8_t ghost = 0;                   // 1 ghost hint
+  std::uint8_t reserved[2] = {0, 0};        // 2
+  };
+
+struct dump_replacement {
+  std::int32_t type = 0;                    // 4 replace table entry type
+  std::uint32_t index = 0;                  // 4 node or hint index
+  };
+
+struct dump_kern_pair {
+  std::uint32_t first = 0;                  // 4 first glyph index in the font
+  std::uint32_t second = 0;                 // 4 second glyph index in the font
+  std::uint32_t values = 0;                 // 4 values: kerning value
+  std::uint32_t reserved = 0;               // 4
+  };
+
+#pragma pack(pop)
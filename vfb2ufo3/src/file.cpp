@@ -2,24 +2,32 @@
 
 #pragma once
 
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <utility>
 #include <vector>
 
 struct cpp_file {
   std::string path;
   std::string data;
-  cpp_file(const std::string &path, const std::string &data) {
+  cpp_file(const std::string &path, std::string data) {
     this->path = path;
-    this->data = data;
+    this->data = std::move(data);
     }
   };
 
-void write_file(const std::string &path, const std::string &data) {
+// writes in text mode, so line endings are those of the platform; returns an
+// error message, or an empty string on success
+std::string write_file(const std::string &path, const std::string &data) {
   std::ofstream file(path);
   file << data;
   file.close();
+  if (not file)
+    return path + ": " + std::strerror(errno);
+  return std::string();
   }
 
 std::string read_file(const std::string &path) {
@@ -5,9 +5,15 @@
 #include <omp.h>
 
 #include "file.cpp"
+#include "output.cpp"
 
-void write_files(const auto &files) {
-  #pragma omp parallel for default(shared)
+// returns a message for each file that failed to write; with a manifest,
+// files unchanged since the previous run are not written
+std::vector<std::string> write_files(const auto &files, cpp_manifest *manifest=nullptr) {
+  file_writer writer;
+  writer.manifest = manifest;
   for (const auto &file : files)
-    write_file(file.path, file.data);
+    writer.add(file.path, std::string_view(file.data));
+  writer.flush();
+  return writer.errors;
   }
@@ -1,17 +1,27 @@
 // glif.cpp
 
+#pragma once
+
 #define FMT_HEADER_ONLY
 #include <fmt/format.h>
 #include <fmt/compile.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
+#include <iterator>
+#include <numeric>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include <omp.h>
 
+#include "archive.cpp"
+#include "output.cpp"
+#include "schedule.cpp"
 #include "glif.hpp"
 #include "mark.hpp"
 #include "string.cpp"
@@ -54,74 +64,167 @@ std::vector<std::string> cpp_anchor::attrs() const {
 std::string cpp_anchor::repr() const {
   return fmt::format(FMT_COMPILE("\t<anchor {}/>\n"), attrs_str(this->attrs()));
   }
+void anchor_repr(auto &buf, const cpp_anchor &anchor) {
+  append(buf, "\t<anchor name=\"");
+  append(buf, anchor.name);
+  append(buf, "\" x=\"");
+  number_str(buf, anchor.x);
+  append(buf, "\" y=\"");
+  number_str(buf, anchor.y);
+  append(buf, "\"/>\n");
+  }
 
 
-cpp_contour_point::cpp_contour_point(float x, float y) {
-  this->x = x;
-  this->y = y;
+void cpp_outlines::reserve(size_t n_contours, size_t n_points) {
+  this->x.reserve(this->x.size() + n_points);
+  this->y.reserve(this->y.size() + n_points);
+  this->types.reserve(this->types.size() + n_points);
+  this->contours.reserve(this->contours.size() + n_contours);
   }
-cpp_contour_point::cpp_contour_point(float x, float y, int type) {
-  this->x = x;
-  this->y = y;
-  this->type = type;
+size_t cpp_outlines::start(size_t contour) const {
+  if (contour < this->contours.size())
+    return this->contours[contour];
+  return this->x.size();
   }
-cpp_contour_point::cpp_contour_point(float x, float y, int type, int alignment) {
-  this->x = x;
-  this->y = y;
-  this->type = type;
-  this->alignment = alignment;
+size_t cpp_outlines::end(size_t contour) const {
+  return this->start(contour + 1);
   }
-cpp_contour_point::cpp_contour_point(float x, float y, int type, int alignment, std::string &name) {
-  this->x = x;
-  this->y = y;
-  this->type = type;
-  this->alignment = alignment;
-  this->name = name;
+void cpp_outlines::add_contour() {
+  this->contours.push_back(this->x.size());
   }
-cpp_contour_point::cpp_contour_point(float x, float y, int type, int alignment, int hintset_index) {
-  this->x = x;
-  this->y = y;
-  this->type = type;
-  this->alignment = alignment;
-  this->name = fmt::format(FMT_COMPILE("hintSet{:04}"), hintset_index);
-  }
-std::vector<std::string> cpp_contour_point::attrs() const {
-  if (not this->type)
-    return {
-      attr("x", number_str(this->x)),
-      attr("y", number_str(this->y)),
-      };
-  if (not this->name.empty()) {
-    if (this->alignment > 0)
-      return {
-        attr("x", number_str(this->x)),
-        attr("y", number_str(this->y)),
-        attr("type", POINT_TYPES[this->type]),
-        attr("smooth", "yes"),
-        attr("name", this->name),
-        };
-    return {
-      attr("x", number_str(this->x)),
-      attr("y", number_str(this->y)),
-      attr("type", POINT_TYPES[this->type]),
-      attr("name", this->name),
-      };
+void cpp_outlines::add_point(float x, float y, int type, int alignment) {
+  this->x.push_back(x);
+  this->y.push_back(y);
+  this->types.push_back(type | (alignment > 0 ? POINT_SMOOTH : 0));
+  }
+void cpp_outlines::add_point(float x, float y, int type, int alignment, int hintset_index) {
+  this->hintsets[this->x.size()] = hintset_index;
+  this->add_point(x, y, type, alignment);
+  }
+void cpp_outlines::set_point(size_t i, float x, float y, int type, int alignment) {
+  this->x[i] = x;
+  this->y[i] = y;
+  this->types[i] = type | (alignment > 0 ? POINT_SMOOTH : 0);
+  }
+void cpp_outlines::set_point(size_t i, float x, float y, int type, int alignment, int hintset_index) {
+  this->hintsets[i] = hintset_index;
+  this->set_point(i, x, y, type, alignment);
+  }
+void cpp_outlines::scale(const cpp_outline &outline, float scale) {
+  for (size_t i = this->start(outline.start); i < this->start(outline.end); i++) {
+    this->x[i] *= scale;
+    this->y[i] *= scale;
     }
-  if (this->alignment > 0)
-    return {
-      attr("x", number_str(this->x)),
-      attr("y", number_str(this->y)),
-      attr("type", POINT_TYPES[this->type]),
-      attr("smooth", "yes"),
-      };
-  return {
-      attr("x", number_str(this->x)),
-      attr("y", number_str(this->y)),
-      attr("type", POINT_TYPES[this->type]),
-      };
   }
-std::string cpp_contour_point::repr() const {
-  return fmt::format(FMT_COMPILE("\t\t\t<point {}/>\n"), attrs_str(this->attrs()));
+
+// builds the contours of a glyph from its nodes; a curve ending on the first
+// point of its contour replaces that point, and with hints, the points of
+// nodes in the replace table start hint sets
+cpp_outline cpp_outlines::add_nodes(cpp_nodes &nodes, bool hints) {
+  cpp_outline outline;
+  bool off = false, cubic = true;
+  size_t start = 0;
+
+  std::sort(nodes.replacements.begin(), nodes.replacements.end());
+  auto add = [&](size_t i, float x, float y, int type, int alignment, bool hintset) {
+    if (hintset)
+      this->add_point(x, y, type, alignment, i);
+    else
+      this->add_point(x, y, type, alignment);
+    };
+
+  this->reserve(nodes.contours.size() + 1, nodes.points + 2);
+  outline.start = this->contours.size();
+  this->add_contour();
+  for (size_t i = 0; i < nodes.types.size(); i++) {
+    const float *x = &nodes.x[i * 3];
+    const float *y = &nodes.y[i * 3];
+    int alignment = nodes.alignments[i];
+    bool hintset = hints and std::binary_search(nodes.replacements.begin(), nodes.replacements.end(), i);
+
+    if (nodes.types[i] == NODE_MOVE) {
+      start = i;
+      if (this->x.size() != this->contours.back())
+        this->add_contour();
+      }
+
+    if (nodes.counts[i] > 1) {
+      cubic = true;
+      this->add_point(x[1], y[1]);
+      this->add_point(x[2], y[2]);
+      if (x[0] == nodes.x[start * 3] and y[0] == nodes.y[start * 3]) {
+        if (hintset)
+          this->set_point(this->contours.back(), x[0], y[0], 1, alignment, i);
+        else
+          this->set_point(this->contours.back(), x[0], y[0], 1, alignment);
+        }
+      else
+        add(i, x[0], y[0], 1, alignment, hintset);
+      }
+    else if (nodes.types[i] == NODE_OFF) {
+      off = true;
+      cubic = false;
+      this->add_point(x[0], y[0]);
+      }
+    else if (cubic)
+      add(i, x[0], y[0], 3, alignment, hintset);
+    else if (off) {
+      this->add_point(x[0], y[0], 2);
+      off = false;
+      }
+    else
+      add(i, x[0], y[0], 3, 0, hintset);
+    }
+  outline.end = this->contours.size();
+  return outline;
+  }
+
+
+void cpp_nodes::clear() {
+  this->x.clear();
+  this->y.clear();
+  this->types.clear();
+  this->counts.clear();
+  this->alignments.clear();
+  this->contours.clear();
+  this->replacements.clear();
+  this->points = 0;
+  }
+void cpp_nodes::add_node(int type, int alignment, float x0, float y0) {
+  this->add_node(type, alignment, x0, y0, 0.0f, 0.0f, 0.0f, 0.0f);
+  this->counts.back() = 1;
+  this->points -= 2;
+  }
+void cpp_nodes::add_node(int type, int alignment, float x0, float y0, float x1, float y1, float x2, float y2) {
+  if (type == NODE_MOVE)
+    this->contours.push_back(this->types.size());
+  this->x.insert(this->x.end(), {x0, x1, x2});
+  this->y.insert(this->y.end(), {y0, y1, y2});
+  this->types.push_back(type);
+  this->counts.push_back(3);
+  this->alignments.push_back(alignment);
+  this->points += 3;
+  }
+void cpp_nodes::add_replacement(size_t index) {
+  this->replacements.push_back(index);
+  }
+
+void point_repr(auto &buf, const cpp_outlines &outlines, size_t i, const cpp_point &point) {
+  u_char type = outlines.types[i];
+  append(buf, "\t\t\t<point x=\"");
+  number_str(buf, point.x);
+  append(buf, "\" y=\"");
+  number_str(buf, point.y);
+  if (type & POINT_TYPE_MASK) {
+    append(buf, "\" type=\"");
+    append(buf, POINT_TYPES[type & POINT_TYPE_MASK]);
+    if (type & POINT_SMOOTH)
+      append(buf, "\" smooth=\"yes");
+    auto hintset = outlines.hintsets.find(i);
+    if (hintset != outlines.hintsets.end())
+      fmt::format_to(std::back_inserter(buf), FMT_COMPILE("\" name=\"hintSet{:04}"), hintset->second);
+    }
+  append(buf, "\"/>\n");
   }
 
 
@@ -150,6 +253,19 @@ std::vector<std::string> cpp_component::attrs() const {
 std::string cpp_component::repr() const {
   return fmt::format(FMT_COMPILE("\t\t<component {}/>\n"), attrs_str(this->attrs()));
   }
+void component_repr(auto &buf, const cpp_component &component) {
+  append(buf, "\t\t<component base=\"");
+  append(buf, component.base);
+  append(buf, "\" xOffset=\"");
+  number_str(buf, component.offset.x);
+  append(buf, "\" yOffset=\"");
+  number_str(buf, component.offset.y);
+  append(buf, "\" xScale=\"");
+  float_str(buf, component.scale.x, 2);
+  append(buf, "\" yScale=\"");
+  float_str(buf, component.scale.y, 2);
+  append(buf, "\"/>\n");
+  }
 
 
 cpp_hint::cpp_hint(float width, float position, bool vertical, bool ghost) {
@@ -180,6 +296,20 @@ std::string cpp_hint::repr2() const {
   return fmt::format(FMT_COMPILE("\t\t\t\t\t<{} {}/>\n"),
     this->vertical ? "vstem" : "hstem", attrs_str(this->attrs()));
   }
+void hint_repr(auto &buf, const cpp_hint &hint) {
+  append(buf, hint.vertical ? "\t\t\t\t\t\t\t<string>vstem " : "\t\t\t\t\t\t\t<string>hstem ");
+  number_str(buf, hint.width);
+  append(buf, " ");
+  number_str(buf, hint.position);
+  append(buf, "</string>\n");
+  }
+void hint_repr2(auto &buf, const cpp_hint &hint) {
+  append(buf, hint.vertical ? "\t\t\t\t\t<vstem pos=\"" : "\t\t\t\t\t<hstem pos=\"");
+  number_str(buf, hint.position);
+  append(buf, "\" width=\"");
+  number_str(buf, hint.width);
+  append(buf, "\"/>\n");
+  }
 
 
 cpp_hint_replacement::cpp_hint_replacement(int type, size_t index) {
@@ -209,85 +339,110 @@ cpp_glif::cpp_glif(
   }
 
 
-std::string contour_repr(const auto &contour) {
-  return fmt::format(FMT_COMPILE("\t\t<contour>\n{}\t\t</contour>\n"), items_repr(contour));
-  }
-
-size_t contours_len(const auto &contours) {
-  size_t i = 0;
-  for (const auto &contour : contours)
-    i += contour.size();
-  return i;
-  }
-
-std::string contours_repr(const auto &contours, size_t n_points) {
-  std::string repr;
-  repr.reserve(n_points * 80);
-  for (const auto &contour : contours)
-    repr += contour_repr(contour);
-  return repr;
+void contours_repr(auto &buf, const cpp_outlines &outlines, const cpp_outline &outline, auto transform) {
+  for (size_t contour = outline.start; contour < outline.end; contour++) {
+    append(buf, "\t\t<contour>\n");
+    for (size_t i = outlines.start(contour); i < outlines.end(contour); i++)
+      point_repr(buf, outlines, i, transform(cpp_point(outlines.x[i], outlines.y[i])));
+    append(buf, "\t\t</contour>\n");
+    }
   }
 
-std::string contours_repr(const auto &contours) {
-  std::string repr;
-  repr.reserve(contours_len(contours) * 80);
-  for (const auto &contour : contours)
-    repr += contour_repr(contour);
-  return repr;
+void contours_repr(auto &buf, const cpp_outlines &outlines, const cpp_outline &outline) {
+  contours_repr(buf, outlines, outline, [](const cpp_point &point) { return point; });
   }
 
-std::string unicode_repr(long code_point) {
+void unicode_repr(auto &buf, long code_point) {
   if (code_point <= 0xffff)
-    return fmt::format(FMT_COMPILE("\t<unicode hex=\"{:04X}\"/>\n"), code_point);
-  return fmt::format(FMT_COMPILE("\t<unicode hex=\"{:05X}\"/>\n"), code_point);
+    fmt::format_to(std::back_inserter(buf), FMT_COMPILE("\t<unicode hex=\"{:04X}\"/>\n"), code_point);
+  else
+    fmt::format_to(std::back_inserter(buf), FMT_COMPILE("\t<unicode hex=\"{:05X}\"/>\n"), code_point);
   }
 
 static const cpp_point NO_SCALE(0.0, 0.0);
 static const cpp_point NO_OFFSET(0.0, 0.0);
 
-std::string add_contours(auto &ufo, const auto &component) {
+cpp_component_key::cpp_component_key(const cpp_component &component) {
+  this->index = component.index;
+  this->offset_x = component.offset.x;
+  this->offset_y = component.offset.y;
+  this->scale_x = component.scale.x;
+  this->scale_y = component.scale.y;
+  }
+bool cpp_component_key::operator==(const cpp_component_key &other) const {
+  return this->index == other.index and
+    this->offset_x == other.offset_x and
+    this->offset_y == other.offset_y and
+    this->scale_x == other.scale_x and
+    this->scale_y == other.scale_y;
+  }
+size_t cpp_component_key_hash::operator()(const cpp_component_key &key) const {
+  size_t hash = std::hash<size_t>{}(key.index);
+  for (float n : {key.offset_x, key.offset_y, key.scale_x, key.scale_y})
+    hash = hash * 31 + std::hash<float>{}(n);
+  return hash;
+  }
 
-  std::string repr;
-  cpp_contours contours;
+void component_contours_repr(auto &buf, const auto &ufo, const cpp_component &component, const cpp_outline &outline) {
+  if (component.offset != NO_OFFSET and component.scale != NO_SCALE)
+    contours_repr(buf, ufo.outlines, outline, [&component](cpp_point point) {
+      point.scale_offset(component.scale, component.offset);
+      return point;
+      });
+  else if (component.offset != NO_OFFSET)
+    contours_repr(buf, ufo.outlines, outline, [&component](cpp_point point) {
+      point.offset(component.offset);
+      return point;
+      });
+  else if (component.scale != NO_SCALE)
+    contours_repr(buf, ufo.outlines, outline, [&component](cpp_point point) {
+      point.scale(component.scale);
+      return point;
+      });
+  else
+    contours_repr(buf, ufo.outlines, outline);
+  }
 
-  if (component.offset == NO_OFFSET and component.scale == NO_SCALE) {
-    if (ufo.completed_contours.find(component.index) == ufo.completed_contours.end()) {
-      contours = *ufo.contours[component.index];
-      repr = contours_repr(contours);
-      ufo.completed_contours[component.index] = repr;
-      return repr;
+// renders the contours of every distinct base, offset and scale used by a
+// component once, so the cache is read-only while glifs are written
+void build_components(cpp_ufo &ufo) {
+  std::vector<std::pair<const cpp_component*, std::string*>> components;
+  for (const auto &glif : ufo.glifs) {
+    if (glif.omit)
+      continue;
+    for (const auto &component : glif.components) {
+      if (ufo.contours.find(component.index) == ufo.contours.end())
+        continue;
+      auto completed = ufo.completed_contours.emplace(cpp_component_key(component), "");
+      if (completed.second)
+        components.emplace_back(&component, &completed.first->second);
       }
-    return ufo.completed_contours[component.index];
     }
 
-  contours = *ufo.contours[component.index];
-  if (component.offset != NO_OFFSET and component.scale != NO_SCALE)
-    for (auto &contour : contours)
-      for (auto &point : contour)
-        point.scale_offset(component.scale, component.offset);
-  else if (component.offset != NO_OFFSET)
-    for (auto &contour : contours)
-      for (auto &point : contour)
-        point.offset(component.offset);
-  else
-    for (auto &contour : contours)
-      for (auto &point : contour)
-        point.scale(component.scale);
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < components.size(); i++) {
+    const auto &component = *components[i].first;
+    fmt::memory_buffer buf;
+    component_contours_repr(buf, ufo, component, ufo.contours.at(component.index));
+    *components[i].second = fmt::to_string(buf);
+    }
+  }
 
-  return contours_repr(contours);
+void add_contours(auto &buf, const auto &ufo, const auto &component) {
+  auto contours = ufo.completed_contours.find(cpp_component_key(component));
+  if (contours != ufo.completed_contours.end())
+    append(buf, contours->second);
   }
 
-void cpp_glif::scale(float scale) {
+void cpp_glif::scale(float scale, cpp_outlines &outlines) {
   if (this->anchors.size())
     for (auto &anchor : this->anchors)
       anchor.scale(scale);
   if (this->components.size())
     for (auto &component : this->components)
       component.offset.scale(scale);
-  if (this->contours.size())
-    for (auto &contour : this->contours)
-      for (auto &point : contour)
-        point.scale(scale);
+  if (this->outline.size())
+    outlines.scale(this->outline, scale);
   if (this->vhints.size())
     for (auto &hint : this->vhints)
       hint.scale(scale);
@@ -306,44 +461,140 @@ size_t cpp_glif::size() const {
     this->hint_replacements.size();
   }
 
-std::string cpp_glif::hint_id() const {
-  std::string id;
-
-  id.reserve((this->len_points * 10) + 20);
-  id += fmt::format(FMT_COMPILE("w'{}"), number_str(this->width));
-  for (const auto &contour : this->contours) {
-    if (contour.size() < 2)
+// walks the hint id of a glif: the advance width, then the type and
+// coordinates of every point in contours of two or more points
+struct hint_id_cursor {
+  const cpp_glif *glif;
+  const cpp_outlines *outlines;
+  size_t contour;
+  size_t i = 0;
+  size_t end = 0;
+  bool started = false;
+  hint_id_cursor(const cpp_glif &glif, const cpp_outlines &outlines)
+    : glif(&glif), outlines(&outlines), contour(glif.outline.start) {}
+  bool next(fmt::memory_buffer &buf);
+  };
+
+// appends the next element of the id to buf; returns false once the id is
+// complete
+bool hint_id_cursor::next(fmt::memory_buffer &buf) {
+  if (not this->started) {
+    append(buf, "w'");
+    number_str(buf, this->glif->width);
+    this->started = true;
+    return true;
+    }
+  while (this->i == this->end) {
+    if (this->contour == this->glif->outline.end)
+      return false;
+    this->i = this->outlines->start(this->contour);
+    this->end = this->outlines->end(this->contour++);
+    if (this->end - this->i < 2)
+      this->i = this->end;
+    }
+  buf.push_back(POINT_TYPES[this->outlines->types[this->i] & POINT_TYPE_MASK][0]);
+  number_str(buf, this->outlines->x[this->i]);
+  buf.push_back(',');
+  number_str(buf, this->outlines->y[this->i++]);
+  return true;
+  }
+
+// ids over 128 bytes are hashed; points are written to a small buffer that is
+// fed to the hash in pieces once the id is known to need hashing
+std::string cpp_glif::hint_id(const cpp_outlines &outlines) const {
+  fmt::memory_buffer buf;
+  sha512::sha512 context;
+  hint_id_cursor cursor(*this, outlines);
+  bool hashing = false;
+
+  while (cursor.next(buf)) {
+    hashing = hashing or buf.size() > 128;
+    if (hashing and buf.size() >= 256) {
+      context.update((const sha512::byte*) buf.data(), buf.size());
+      buf.clear();
+      }
+    }
+  if (not hashing)
+    return fmt::to_string(buf);
+  context.update((const sha512::byte*) buf.data(), buf.size());
+  context.finish();
+  return context.str();
+  }
+
+// reads the hint id of a glif on each sha512 lane a block at a time; the
+// first block is kept as the id of a glif whose id is 128 bytes or less
+struct hint_id_source {
+  const std::vector<const cpp_glif*> &glifs;
+  const cpp_outlines &outlines;
+  std::vector<std::string> &ids;
+  std::vector<hint_id_cursor> cursors;
+  std::vector<fmt::memory_buffer> bufs;
+  std::vector<std::string> heads;
+  hint_id_source(const std::vector<const cpp_glif*> &glifs, const cpp_outlines &outlines, std::vector<std::string> &ids, size_t lanes)
+    : glifs(glifs), outlines(outlines), ids(ids), bufs(lanes), heads(lanes) {
+    this->cursors.reserve(lanes);
+    for (size_t l = 0; l < lanes; l++)
+      this->cursors.emplace_back(*glifs[0], outlines);
+    }
+  void start(size_t lane, size_t i) {
+    this->cursors[lane] = hint_id_cursor(*this->glifs[i], this->outlines);
+    this->bufs[lane].clear();
+    this->heads[lane].clear();
+    }
+  size_t read(size_t lane, sha512::byte *block) {
+    auto &buf = this->bufs[lane];
+    while (buf.size() < 128 and this->cursors[lane].next(buf))
       continue;
-    for (const auto &point : contour)
-      id += fmt::format(FMT_COMPILE("{}{},{}"), POINT_TYPES[point.type][0], number_str(point.x), number_str(point.y));
+    size_t len = std::min(buf.size(), (size_t) 128);
+    std::memcpy(block, buf.data(), len);
+    if (this->heads[lane].empty())
+      this->heads[lane].assign(buf.data(), len);
+    std::memmove(buf.data(), buf.data() + len, buf.size() - len);
+    buf.resize(buf.size() - len);
+    return len;
     }
-  if (id.size() > 128)
-    return sha512::hash(id);
-  return id;
-  }
-
-std::string cpp_glif::hints_repr(auto hint_type) const {
-
-  std::string hints_repr;
-  std::string hintsets_str;
-  size_t n = (hint_replacements.size() ? hint_replacements.size() : vhints.size() + vhints.size()) * 50;
+  void done(size_t lane, size_t i, const std::uint64_t *h, std::uint32_t len) {
+    this->ids[i] = len > 128 ? sha512::digest_str(h) : this->heads[lane];
+    }
+  };
 
-  hintsets_str.reserve(n);
-  hints_repr.reserve(n + 600);
+// builds the public hint id of every hinted glif before the glifs are
+// written, streaming the ids through multi-lane sha512 where the CPU allows,
+// so the ids are read-only while glifs are written
+void build_hint_ids(cpp_ufo &ufo) {
+  std::vector<const cpp_glif*> glifs;
+  for (const auto &glif : ufo.glifs)
+    if (not glif.omit and (glif.vhints.size() or glif.hhints.size()))
+      glifs.push_back(&glif);
+
+  std::vector<std::string> ids(glifs.size());
+  size_t lanes = sha512::lane_count(0);
+  if (lanes == 1) {
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < glifs.size(); i++)
+      ids[i] = glifs[i]->hint_id(ufo.outlines);
+    }
+  else {
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t first = 0; first < glifs.size(); first += sha512::LANE_BATCH) {
+      hint_id_source source(glifs, ufo.outlines, ids, lanes);
+      sha512::hash_lanes(first, std::min(first + sha512::LANE_BATCH, glifs.size()), lanes, source);
+      }
+    }
 
-  if (hint_type == 1)
-    return this->hints_adobe_v1_repr(hints_repr, hintsets_str);
-  if (hint_type == 2)
-    return this->hints_adobe_v2_repr(hints_repr, hintsets_str);
-  return this->hints_public_repr(hints_repr, hintsets_str);
+  ufo.hint_ids.clear();
+  ufo.hint_ids.reserve(glifs.size());
+  for (size_t i = 0; i < glifs.size(); i++)
+    ufo.hint_ids.emplace(glifs[i]->index, std::move(ids[i]));
   }
 
-void hintsets_repr(std::string &repr, const auto &hint_replacements, auto &vhints, auto &hhints) {
+void hintsets_repr(auto &buf, const auto &hint_replacements, const auto &vhints, const auto &hhints) {
+  size_t start = buf.size();
   for (const auto &hint_replacement : hint_replacements) {
     if (hint_replacement.type == 255) {
-      if (not repr.empty())
-        repr += "\t\t\t\t\t\t</array>\n";
-      repr += fmt::format(FMT_COMPILE(
+      if (buf.size() != start)
+        append(buf, "\t\t\t\t\t\t</array>\n");
+      fmt::format_to(std::back_inserter(buf), FMT_COMPILE(
         "\t\t\t\t\t\t<key>pointTag</key>\n"
         "\t\t\t\t\t\t<string>hintSet{:04}</string>\n"
         "\t\t\t\t\t\t<key>stems</key>\n"
@@ -351,15 +602,27 @@ void hintsets_repr(std::string &repr, const auto &hint_replacements, auto &vhint
         hint_replacement.index);
       }
     else if (hint_replacement.type == 1)
-      repr += hhints[hint_replacement.index].repr();
+      hint_repr(buf, hhints[hint_replacement.index]);
     else
-      repr += vhints[hint_replacement.index].repr();
+      hint_repr(buf, vhints[hint_replacement.index]);
+    }
+  }
+
+void hints_stems_repr(auto &buf, const cpp_glif &glif) {
+  if (glif.hint_replacements.empty()) {
+    for (const auto &hint : glif.hhints)
+      hint_repr(buf, hint);
+    for (const auto &hint : glif.vhints)
+      hint_repr(buf, hint);
     }
+  else
+    hintsets_repr(buf, glif.hint_replacements, glif.vhints, glif.hhints);
   }
 
-std::string cpp_glif::hints_public_repr(std::string &hints_repr, std::string &hintsets_str) const {
+void hints_public_repr(auto &buf, const cpp_glif &glif, const auto &ufo) {
+  auto hint_id = ufo.hint_ids.find(glif.index);
 
-  hints_repr += fmt::format(FMT_COMPILE(
+  fmt::format_to(std::back_inserter(buf), FMT_COMPILE(
     "\t\t\t<key>public.postscript.hints</key>\n"
     "\t\t\t<dict>\n"
     "\t\t\t\t<key>formatVersion</key>\n"
@@ -373,65 +636,53 @@ std::string cpp_glif::hints_public_repr(std::string &hints_repr, std::string &hi
     "\t\t\t\t\t\t<string>hintSet0000</string>\n"
     "\t\t\t\t\t\t<key>stems</key>\n"
     "\t\t\t\t\t\t<array>\n"),
-    this->hint_id());
+    hint_id != ufo.hint_ids.end() ? hint_id->second : glif.hint_id(ufo.outlines));
 
-  if (this->hint_replacements.empty()) {
-    if (this->hhints.size())
-      hintsets_str += items_repr(this->hhints);
-    if (this->vhints.size())
-      hintsets_str += items_repr(this->vhints);
-    }
-  else
-    hintsets_repr(hintsets_str, this->hint_replacements, this->vhints, this->hhints);
+  hints_stems_repr(buf, glif);
 
-  hints_repr += hintsets_str;
-  hints_repr += "\t\t\t\t\t\t</array>\n"
+  append(buf, "\t\t\t\t\t\t</array>\n"
     "\t\t\t\t\t</dict>\n"
     "\t\t\t\t</array>\n"
-    "\t\t\t</dict>\n";
-  return hints_repr;
+    "\t\t\t</dict>\n");
   }
 
-std::string cpp_glif::hints_adobe_v1_repr(std::string &hints_repr, std::string &hintsets_str) const {
+void hints_adobe_v1_repr(auto &buf, const cpp_glif &glif) {
 
-  hints_repr += "\t\t\t<key>com.adobe.type.autohint</key>\n"
+  append(buf, "\t\t\t<key>com.adobe.type.autohint</key>\n"
     "\t\t\t<data>\n"
     "\t\t\t<hintSetList>\n"
-    "\t\t\t\t<hintset pointTag=\"hintSet0000\">\n";
-
-  if (this->hint_replacements.empty()) {
-    if (this->hhints.size())
-      for (const auto &hint : this->hhints)
-        hintsets_str += hint.repr2();
-    if (this->vhints.size())
-      for (const auto &hint : this->vhints)
-        hintsets_str += hint.repr2();
+    "\t\t\t\t<hintset pointTag=\"hintSet0000\">\n");
+
+  if (glif.hint_replacements.empty()) {
+    for (const auto &hint : glif.hhints)
+      hint_repr2(buf, hint);
+    for (const auto &hint : glif.vhints)
+      hint_repr2(buf, hint);
     }
   else {
-    for (const auto &hint_replacement : this->hint_replacements) {
+    size_t start = buf.size();
+    for (const auto &hint_replacement : glif.hint_replacements) {
       if (hint_replacement.type == 255) {
-        if (not hintsets_str.empty())
-          hintsets_str += "\t\t\t\t</hintset>\n";
-        hintsets_str += fmt::format(FMT_COMPILE("\t\t\t\t<hintset pointTag=\"hintSet{:04}\">\n"),
+        if (buf.size() != start)
+          append(buf, "\t\t\t\t</hintset>\n");
+        fmt::format_to(std::back_inserter(buf), FMT_COMPILE("\t\t\t\t<hintset pointTag=\"hintSet{:04}\">\n"),
           hint_replacement.index);
         }
       else if (hint_replacement.type == 1)
-        hintsets_str += this->hhints[hint_replacement.index].repr2();
+        hint_repr2(buf, glif.hhints[hint_replacement.index]);
       else
-        hintsets_str += this->vhints[hint_replacement.index].repr2();
+        hint_repr2(buf, glif.vhints[hint_replacement.index]);
       }
     }
 
-  hints_repr += hintsets_str;
-  hints_repr += "\t\t\t\t</hintset>\n"
+  append(buf, "\t\t\t\t</hintset>\n"
     "\t\t\t</hintSetList>\n"
-    "\t\t\t</data>\n";
-  return hints_repr;
+    "\t\t\t</data>\n");
   }
 
-std::string cpp_glif::hints_adobe_v2_repr(std::string &hints_repr, std::string &hintsets_str) const {
+void hints_adobe_v2_repr(auto &buf, const cpp_glif &glif) {
 
-  hints_repr += "\t\t\t<key>com.adobe.type.autohint.v2</key>\n"
+  append(buf, "\t\t\t<key>com.adobe.type.autohint.v2</key>\n"
     "\t\t\t<dict>\n"
     "\t\t\t\t<key>hintSetList</key>\n"
     "\t\t\t\t<array>\n"
@@ -439,95 +690,189 @@ std::string cpp_glif::hints_adobe_v2_repr(std::string &hints_repr, std::string &
     "\t\t\t\t\t\t<key>pointTag</key>\n"
     "\t\t\t\t\t\t<string>hintSet0000</string>\n"
     "\t\t\t\t\t\t<key>stems</key>\n"
-    "\t\t\t\t\t\t<array>\n";
+    "\t\t\t\t\t\t<array>\n");
 
-  if (this->hint_replacements.empty()) {
-    if (this->hhints.size())
-      hintsets_str += items_repr(this->hhints);
-    if (this->vhints.size())
-      hintsets_str += items_repr(this->vhints);
-    }
-  else
-    hintsets_repr(hintsets_str, this->hint_replacements, this->vhints, this->hhints);
+  hints_stems_repr(buf, glif);
 
-  hints_repr += hintsets_str;
-  hints_repr += "\t\t\t\t\t\t</array>\n"
+  append(buf, "\t\t\t\t\t\t</array>\n"
     "\t\t\t\t\t</dict>\n"
     "\t\t\t\t</array>\n"
-    "\t\t\t</dict>\n";
-  return hints_repr;
+    "\t\t\t</dict>\n");
   }
 
-void cpp_glif::build_contours(auto &ufo) const {
-  ufo.completed_contours[this->index] = contours_repr(this->contours);
+void hints_repr(auto &buf, const cpp_glif &glif, const auto &ufo) {
+  if (ufo.hint_type == 1)
+    hints_adobe_v1_repr(buf, glif);
+  else if (ufo.hint_type == 2)
+    hints_adobe_v2_repr(buf, glif);
+  else
+    hints_public_repr(buf, glif, ufo);
   }
 
-std::string cpp_glif::repr(auto &ufo) const {
+void glif_repr(auto &buf, const cpp_glif &glif, auto &ufo) {
 
-  std::string text;
-  bool has_components = this->components.size();
-  bool has_contours = this->contours.size();
-  bool has_mark = this->mark > 0;
-  bool has_hints = this->vhints.size() or this->hhints.size();
+  // every element of the glif is written directly into a single buffer
+  bool has_components = glif.components.size();
+  bool has_contours = glif.outline.size();
+  bool has_mark = glif.mark > 0;
+  bool has_hints = glif.vhints.size() or glif.hhints.size();
 
-  text.reserve(this->size() * 120);
-  text += fmt::format(FMT_COMPILE(
-    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-    "<glyph name=\"{}\" format=\"2\">\n"
-    "\t<advance width=\"{}\"/>\n"),
-    this->name, number_str(this->width));
+  buf.reserve(buf.size() + glif.size() * 120);
+  append(buf, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<glyph name=\"");
+  append(buf, glif.name);
+  append(buf, "\" format=\"2\">\n"
+    "\t<advance width=\"");
+  number_str(buf, glif.width);
+  append(buf, "\"/>\n");
 
-  if (this->code_points.size())
-    for (const auto &code_point : this->code_points)
-      text += unicode_repr(code_point);
+  for (const auto &code_point : glif.code_points)
+    unicode_repr(buf, code_point);
 
-  if (this->anchors.size())
-    text += items_repr(this->anchors);
+  for (const auto &anchor : glif.anchors)
+    anchor_repr(buf, anchor);
 
   if (has_components or has_contours)
-    text += "\t<outline>\n";
+    append(buf, "\t<outline>\n");
 
   if (has_components and ufo.optimize)
-    for (const auto &component : this->components)
-      text += add_contours(ufo, component);
-  else if (has_components)
-    text += items_repr(this->components);
+    for (const auto &component : glif.components)
+      add_contours(buf, ufo, component);
+  else
+    for (const auto &component : glif.components)
+      component_repr(buf, component);
 
   if (has_contours)
-    text += contours_repr(this->contours, this->len_points);
+    contours_repr(buf, ufo.outlines, glif.outline);
 
   if (has_components or has_contours)
-    text += "\t</outline>\n";
+    append(buf, "\t</outline>\n");
 
   if (has_mark or has_hints)
-    text += "\t<lib>\n\t\t<dict>\n";
+    append(buf, "\t<lib>\n\t\t<dict>\n");
 
-  if (has_mark)
-    text += fmt::format(FMT_COMPILE("\t\t\t<key>public.markColor</key>\n"
-      "\t\t\t<string>{}</string>\n"), MARK_COLORS[this->mark]);
+  if (has_mark) {
+    append(buf, "\t\t\t<key>public.markColor</key>\n"
+      "\t\t\t<string>");
+    append(buf, MARK_COLORS[glif.mark]);
+    append(buf, "</string>\n");
+    }
 
   if (has_hints)
-    text += this->hints_repr(ufo.hint_type);
+    hints_repr(buf, glif, ufo);
 
   if (has_mark or has_hints)
-    text += "\t\t</dict>\n\t</lib>\n";
+    append(buf, "\t\t</dict>\n\t</lib>\n");
 
-  text += "</glyph>\n";
-  text.shrink_to_fit();
+  append(buf, "</glyph>\n");
+  }
+
+std::string cpp_glif::repr(auto &ufo) const {
+  fmt::memory_buffer buf;
+  glif_repr(buf, *this, ufo);
+  return fmt::to_string(buf);
+  }
 
-  return text;
+// renders a glif straight into the calling thread's arena; the view is valid
+// until the arenas are released
+std::string_view arena_repr(const cpp_glif &glif, auto &ufo, arena_pool &arenas) {
+  return arenas.render([&](auto &buf) { glif_repr(buf, glif, ufo); });
   }
 
-void cpp_glif::write(auto &ufo) const {
-  std::ofstream file(this->path);
-  file << this->repr(ufo);
-  file.close();
+int cpp_glif::write(auto &ufo) const {
+  return write_output_file(this->path, this->repr(ufo));
   }
 
-void write_glifs(cpp_ufo &ufo) {
-  #pragma omp parallel for
+// estimated relative cost of rendering a glif: points dominate, and
+// optimized components add the points of their base; public hint ids are
+// built beforehand by build_hint_ids
+size_t glif_cost(const cpp_glif &glif, const cpp_ufo &ufo) {
+  size_t cost = glif.size() + glif.len_points;
+  if (ufo.optimize)
+    for (const auto &component : glif.components) {
+      auto outline = ufo.contours.find(component.index);
+      if (outline != ufo.contours.end())
+        cost += ufo.outlines.start(outline->second.end) - ufo.outlines.start(outline->second.start);
+      }
+  return cost;
+  }
+
+// renders glifs in batches of similar cost, most expensive first, and hands
+// each batch to a file_writer, which skips glifs the ufo manifest has as
+// unchanged; the batch is rendered into per-thread arenas that are released
+// once it is written. returns a message for each file that failed
+std::vector<std::string> write_glifs(cpp_ufo &ufo) {
+  ufo.times = thread_times();
+  if (ufo.optimize)
+    build_components(ufo);
+  if (ufo.hint_type == 3)
+    build_hint_ids(ufo);
+
+  std::vector<const cpp_glif*> glifs;
+  glifs.reserve(ufo.glifs.size());
   for (const auto &glif : ufo.glifs)
     if (not glif.omit)
-      glif.write(ufo);
+      glifs.push_back(&glif);
+  auto order = cost_order(glifs.size(), [&](size_t i) { return glif_cost(*glifs[i], ufo); });
+
+  file_writer writer;
+  writer.manifest = ufo.manifest;
+  arena_pool arenas;
+  for (size_t start = 0; start < order.size(); start += OUTPUT_BATCH_SIZE) {
+    size_t end = std::min(start + OUTPUT_BATCH_SIZE, order.size());
+    std::vector<size_t> batch(end - start);
+    std::iota(batch.begin(), batch.end(), 0);
+
+    writer.files.resize(batch.size());
+    run_ordered(batch, [&](size_t i) {
+      const auto &glif = *glifs[order[start + i]];
+      writer.files[i] = output_file(glif.path, arena_repr(glif, ufo, arenas));
+      }, &ufo.times);
+    writer.flush();
+    arenas.release();
+    }
+  return writer.errors;
   }
 
+void archive_glifs(cpp_ufo &ufo, zip::zip_file &archive) {
+  ufo.times = thread_times();
+  if (ufo.optimize)
+    build_components(ufo);
+  if (ufo.hint_type == 3)
+    build_hint_ids(ufo);
+
+  std::vector<const cpp_glif*> glifs;
+  glifs.reserve(ufo.glifs.size());
+  for (const auto &glif : ufo.glifs)
+    if (not glif.omit)
+      glifs.push_back(&glif);
+
+  // with an archive memory limit, glifs are rendered in batches estimated
+  // to fit within the limit and each batch is flushed before the next
+  size_t start = 0;
+  while (start < glifs.size()) {
+    size_t end = glifs.size();
+    if (archive.memory_limit) {
+      size_t batch_size = archive.entries_size;
+      for (end = start; end < glifs.size() and batch_size < archive.memory_limit; end++)
+        batch_size += glifs[end]->size() * 120;
+      }
+
+    size_t offset = archive.entries.size();
+    archive.entries.resize(offset + end - start);
+
+    // entries keep their archive order while the batch is rendered most
+    // expensive first
+    auto order = cost_order(end - start, [&](size_t i) { return glif_cost(*glifs[start + i], ufo); });
+    run_ordered(order, [&](size_t i) {
+      archive.entries[offset + i] = zip::zip_entry(glifs[start + i]->path, arena_repr(*glifs[start + i], ufo, archive.arenas));
+      }, &ufo.times);
+
+    if (archive.memory_limit) {
+      for (size_t i = offset; i < archive.entries.size(); i++)
+        archive.entries_size += archive.entries[i].data.size();
+      archive.write_entries();
+      }
+    start = end;
+    }
+  }
@@ -16,23 +16,179 @@ static const std::vector<std::string> HINT_TYPES = {
   "public.postscript.hints",
   };
 
-struct cpp_anchor;
-struct cpp_contour_point;
-struct cpp_component;
-struct cpp_hint;
-struct cpp_hint_replacement;
-struct cpp_glif;
+// packed point type byte: the POINT_TYPES index in the low bits, and
+// whether the point is smooth
+#define POINT_TYPE_MASK (0x03)
+#define POINT_SMOOTH (0x04)
 
-typedef std::vector<cpp_contour_point> cpp_contour;
-typedef std::vector<cpp_contour> cpp_contours;
+// FontLab node types
+#define NODE_MOVE (17)
+#define NODE_OFF (65)
+
+struct cpp_nodes;
+
+// range of contours in cpp_outlines belonging to one glif
+struct cpp_outline {
+  size_t start = 0;
+  size_t end = 0;
+  size_t size() const {
+    return this->end - this->start;
+    }
+  };
+
+// flat outline store shared by every glif in a font
+//
+// points are held as parallel x/y/type arrays, and each contour as the
+// offset of its first point; the few points that start a hint set are kept
+// in a side table instead of carrying a name on every point
+struct cpp_outlines {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<u_char> types;
+  std::vector<size_t> contours;
+  std::unordered_map<size_t, int> hintsets;
+  void reserve(size_t n_contours, size_t n_points);
+  size_t start(size_t contour) const;
+  size_t end(size_t contour) const;
+  void add_contour();
+  void add_point(float x, float y, int type=0, int alignment=0);
+  void add_point(float x, float y, int type, int alignment, int hintset_index);
+  void set_point(size_t i, float x, float y, int type, int alignment);
+  void set_point(size_t i, float x, float y, int type, int alignment, int hintset_index);
+  void scale(const cpp_outline &outline, float scale);
+  cpp_outline add_nodes(cpp_nodes &nodes, bool hints);
+  };
+
+// nodes of one FontLab glyph, read by glif_nodes() in glif.pyx in a single
+// pass and turned into contours by cpp_outlines::add_nodes
+//
+// every node holds three x/y pairs, of which only the first is set for a node
+// with one point; contours are the indexes of the move nodes, and
+// replacements the indexes of the nodes starting a hint set
+struct cpp_nodes {
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<u_char> types;
+  std::vector<u_char> counts;
+  std::vector<int> alignments;
+  std::vector<size_t> contours;
+  std::vector<size_t> replacements;
+  size_t points = 0;
+  void clear();
+  void add_node(int type, int alignment, float x0, float y0);
+  void add_node(int type, int alignment, float x0, float y0, float x1, float y1, float x2, float y2);
+  void add_replacement(size_t index);
+  };
+
+struct cpp_point {
+  float x = 0;
+  float y = 0;
+  cpp_point() {}
+  cpp_point(float x, float y);
+  void scale(const float scale);
+  void scale(const cpp_point &scale);
+  void offset(const cpp_point &offset);
+  void scale_offset(const cpp_point &scale, const cpp_point &offset);
+  bool operator==(const cpp_point &other) const {
+    return this->x == other.x and this->y == other.y;
+    }
+  bool operator!=(const cpp_point &other) const {
+    return not (*this == other);
+    }
+  };
+
+struct cpp_anchor : cpp_point {
+  std::string name;
+  cpp_anchor(const std::string &name, float x, float y);
+  std::vector<std::string> attrs() const;
+  std::string repr() const;
+  };
+
+// component of a base glyph; index is the position of the base in the font
+struct cpp_component {
+  std::string base;
+  size_t index;
+  cpp_point offset;
+  cpp_point scale;
+  cpp_component(const std::string &base, size_t index, float offset_x, float offset_y, float scale_x, float scale_y);
+  std::vector<std::string> attrs() const;
+  std::string repr() const;
+  };
+
+// ghost hints keep their width when scaled
+struct cpp_hint {
+  float width;
+  float position;
+  bool vertical;
+  bool ghost;
+  cpp_hint(float width, float position, bool vertical, bool ghost);
+  void scale(float scale);
+  std::vector<std::string> attrs() const;
+  std::string repr() const;
+  std::string repr2() const;
+  };
+
+// FontLab hint replacement: type 255 starts a new hint set at a node, and
+// types 1 and 2 add the horizontal or vertical hint at index to it
+struct cpp_hint_replacement {
+  int type;
+  size_t index;
+  cpp_hint_replacement(int type, size_t index);
+  };
+
+// one glyph of an instance; its contours are held in the font's
+// cpp_outlines, and index is the glyph's position in the FontLab font
+struct cpp_glif {
+  std::string name;
+  std::string path;
+  int mark = 0;
+  float width = 0;
+  size_t index = 0;
+  size_t len_points = 0;
+  bool omit = false;
+  bool base = false;
+  std::vector<long> code_points;
+  std::vector<cpp_anchor> anchors;
+  std::vector<cpp_component> components;
+  std::vector<cpp_hint> vhints;
+  std::vector<cpp_hint> hhints;
+  std::vector<cpp_hint_replacement> hint_replacements;
+  cpp_outline outline;
+  cpp_glif() {}
+  cpp_glif(const std::string &name, const std::string &path, int mark, float width, size_t index, size_t len_points, bool omit, bool base);
+  void scale(float scale, cpp_outlines &outlines);
+  size_t size() const;
+  std::string hint_id(const cpp_outlines &outlines) const;
+  std::string repr(auto &ufo) const;
+  int write(auto &ufo) const;
+  };
+
+// base glyph index, offset and scale of a component
+struct cpp_component_key {
+  size_t index;
+  float offset_x;
+  float offset_y;
+  float scale_x;
+  float scale_y;
+  explicit cpp_component_key(const cpp_component &component);
+  bool operator==(const cpp_component_key &other) const;
+  };
+
+struct cpp_component_key_hash {
+  size_t operator()(const cpp_component_key &key) const;
+  };
 
 struct cpp_ufo {
   std::vector<cpp_glif> glifs;
-  std::unordered_map<size_t, cpp_contours*> contours;
-  std::unordered_map<size_t, std::string> completed_contours;
+  cpp_outlines outlines;
+  std::unordered_map<size_t, cpp_outline> contours;
+  std::unordered_map<cpp_component_key, std::string, cpp_component_key_hash> completed_contours;
+  std::unordered_map<size_t, std::string> hint_ids;
+  thread_times times;
   int hint_type;
   bool optimize;
   bool ufoz;
+  cpp_manifest *manifest = nullptr;
   void reserve(size_t n) {
     this->glifs.reserve(n);
     this->contours.reserve(n);
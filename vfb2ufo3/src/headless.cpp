@@ -0,0 +1,272 @@
+// headless.cpp
+
+// builds a UFO or .ufoz instance from a glyph dump written by the
+// `dump_path` option, without FontLab
+//
+// g++ -std=c++20 -O2 -fopenmp src/headless.cpp -lz -o vfb2ufo3-headless
+// vfb2ufo3-headless <dump> <output .ufo or .ufoz> [--instance v0,v1..]
+//   [--master n] [--style name] [--upm n] [--hints public|afdko_v1|afdko_v2]
+//   [--compress-policy policy] [--no-compress] [--incremental]
+//
+// glyph outlines, components, anchors and hints are written as glifs() does;
+// decomposition, overlap removal, fontinfo beyond the family and style names,
+// kerning, groups and features still need FontLab
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "files.cpp"
+#include "instance.cpp"
+#include "plist.cpp"
+
+#define UFO_CREATOR "com.spiratype"
+
+struct headless_options {
+  std::string dump_path;
+  std::string output_path;
+  std::vector<double> instance_values;
+  int master = -1;
+  std::string style_name = "Regular";
+  size_t upm = 0;
+  int hint_type = 0;
+  bool compress = true;
+  std::string compress_policy;
+  bool incremental = false;
+  };
+
+std::string metainfo_plist() {
+  cpp_plist plist;
+  plist.begin_dict();
+  plist.add_key("creator");
+  plist.add_string(UFO_CREATOR);
+  plist.add_key("formatVersion");
+  plist.add_integer(3);
+  plist.end_dict();
+  return plist.finish();
+  }
+
+std::string fontinfo_plist(const dump_reader &dump, const headless_options &options, size_t upm) {
+  cpp_plist plist;
+  plist.begin_dict();
+  plist.add_key("familyName");
+  plist.add_string(dump.str(dump.header->family_name));
+  plist.add_key("styleName");
+  plist.add_string(options.style_name);
+  plist.add_key("unitsPerEm");
+  plist.add_integer(upm);
+  plist.end_dict();
+  return plist.finish();
+  }
+
+std::string lib_plist(const cpp_ufo &ufo) {
+  cpp_plist plist;
+  plist.reserve(ufo.glifs.size() * 32);
+  plist.begin_dict();
+  plist.add_key("public.glyphOrder");
+  plist.begin_array();
+  for (const auto &glif : ufo.glifs)
+    if (not glif.omit)
+      plist.add_string(glif.name);
+  plist.end_array();
+  plist.add_key("com.schriftgestaltung.disablesAutomaticAlignment");
+  plist.add_bool(true);
+  plist.add_key("com.schriftgestaltung.disablesLastChange");
+  plist.add_bool(true);
+  plist.add_key("com.schriftgestaltung.useNiceNames");
+  plist.add_bool(false);
+  plist.end_dict();
+  return plist.finish();
+  }
+
+std::string glyphs_contents_plist(const cpp_ufo &ufo) {
+  cpp_plist plist;
+  plist.reserve(ufo.glifs.size() * 64);
+  plist.begin_dict();
+  for (const auto &glif : ufo.glifs)
+    if (not glif.omit) {
+      plist.add_key(glif.name);
+      plist.add_string(std::filesystem::path(glif.path).filename().string());
+      }
+  plist.end_dict();
+  return plist.finish();
+  }
+
+std::string layercontents_plist() {
+  cpp_plist plist;
+  plist.begin_array();
+  plist.begin_array();
+  plist.add_string("public.default");
+  plist.add_string("glyphs");
+  plist.end_array();
+  plist.end_array();
+  return plist.finish();
+  }
+
+int usage() {
+  std::cerr <<
+    "usage: vfb2ufo3-headless <dump> <output .ufo or .ufoz> [--instance v0,v1..]\n"
+    "  [--master n] [--style name] [--upm n] [--hints public|afdko_v1|afdko_v2]\n"
+    "  [--compress-policy policy] [--no-compress] [--incremental]\n";
+  return 2;
+  }
+
+bool parse_args(headless_options &options, int argc, char *argv[]) {
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--instance" and has_value) {
+      std::stringstream values(argv[++i]);
+      std::string value;
+      while (std::getline(values, value, ','))
+        options.instance_values.push_back(std::stod(value));
+      }
+    else if (arg == "--master" and has_value)
+      options.master = std::stoi(argv[++i]);
+    else if (arg == "--style" and has_value)
+      options.style_name = argv[++i];
+    else if (arg == "--upm" and has_value)
+      options.upm = std::stoul(argv[++i]);
+    else if (arg == "--hints" and has_value) {
+      std::string hints = argv[++i];
+      if (hints == "afdko_v1")
+        options.hint_type = 1;
+      else if (hints == "afdko_v2")
+        options.hint_type = 2;
+      else if (hints == "public")
+        options.hint_type = 3;
+      else
+        return false;
+      }
+    else if (arg == "--compress-policy" and has_value)
+      options.compress_policy = argv[++i];
+    else if (arg == "--no-compress")
+      options.compress = false;
+    else if (arg == "--incremental")
+      options.incremental = true;
+    else if (arg.rfind("--", 0) == 0)
+      return false;
+    else
+      positional.push_back(arg);
+    }
+  if (positional.size() != 2)
+    return false;
+  options.dump_path = positional[0];
+  options.output_path = positional[1];
+  return true;
+  }
+
+int main(int argc, char *argv[]) {
+  headless_options options;
+  try {
+    if (not parse_args(options, argc, argv))
+      return usage();
+    }
+  catch (const std::exception&) {
+    return usage();
+    }
+
+  auto start = std::chrono::steady_clock::now();
+
+  dump_reader dump;
+  std::string error = dump.open(options.dump_path);
+  if (not error.empty()) {
+    std::cerr << error << '\n';
+    return 1;
+    }
+
+  size_t axes = dump.header->axes;
+  std::vector<double> weights;
+  if (options.master >= 0) {
+    if ((size_t) options.master >= dump.header->masters) {
+      std::cerr << "master " << options.master << " not in dump with " << dump.header->masters << " masters\n";
+      return 1;
+      }
+    weights.assign(dump.header->masters, 0.0);
+    weights[options.master] = 1.0;
+    }
+  else {
+    if (options.instance_values.size() > axes) {
+      std::cerr << "instance has " << options.instance_values.size() << " values for " << axes << " axes\n";
+      return 1;
+      }
+    weights = master_weights(options.instance_values, axes);
+    }
+
+  // scaled as parse_options() scales to scale_to_upm
+  size_t upm = dump.header->upm;
+  float scale = 0.0f;
+  if (options.upm >= 1000 and options.upm != upm) {
+    scale = (float) options.upm / upm;
+    upm = options.upm;
+    }
+
+  // archive members are named relative to the archive, as with the ufoz
+  // option
+  std::filesystem::path output_path(options.output_path);
+  bool ufoz = output_path.extension() == ".ufoz";
+  std::string ufo_path = ufoz ? output_path.filename().replace_extension(".ufo").string() : output_path.string();
+  std::string glyphs_path = ufo_path + "/glyphs";
+
+  cpp_ufo ufo;
+  ufo.hint_type = options.hint_type;
+  ufo.optimize = false;
+  ufo.ufoz = ufoz;
+  build_ufo(dump, weights, ufo, glyphs_path, scale);
+
+  std::vector<cpp_file> files = {
+    cpp_file(ufo_path + "/metainfo.plist", metainfo_plist()),
+    cpp_file(ufo_path + "/fontinfo.plist", fontinfo_plist(dump, options, upm)),
+    cpp_file(ufo_path + "/lib.plist", lib_plist(ufo)),
+    cpp_file(glyphs_path + "/contents.plist", glyphs_contents_plist(ufo)),
+    cpp_file(ufo_path + "/layercontents.plist", layercontents_plist()),
+    };
+
+  std::vector<std::string> errors;
+  if (ufoz) {
+    zip::zip_file archive(options.output_path, options.compress, 0, options.compress_policy, options.incremental);
+    if (not archive.archive.is_open()) {
+      std::cerr << options.output_path << ": " << std::strerror(errno) << '\n';
+      return 1;
+      }
+    archive.reserve(ufo.glifs.size() + files.size());
+    archive_glifs(ufo, archive);
+    for (const auto &file : files)
+      archive.add_entry(file.path, file.data);
+    std::string error = archive.close();
+    if (not error.empty())
+      errors.push_back(error);
+    }
+  else {
+    std::error_code ec;
+    std::filesystem::create_directories(glyphs_path, ec);
+    if (ec) {
+      std::cerr << glyphs_path << ": " << ec.message() << '\n';
+      return 1;
+      }
+    std::unique_ptr<cpp_manifest> manifest;
+    if (options.incremental)
+      manifest = std::make_unique<cpp_manifest>(ufo_path + ".manifest");
+    ufo.manifest = manifest.get();
+    errors = write_glifs(ufo);
+    for (const auto &file_error : write_files(files, manifest.get()))
+      errors.push_back(file_error);
+    if (manifest and errors.empty())
+      errors = manifest->finish();
+    }
+
+  for (const auto &file_error : errors)
+    std::cerr << file_error << '\n';
+  if (not errors.empty())
+    return 1;
+
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+  std::cout << fmt::format("{} completed ({} glifs, {:.2f} sec)\n", options.output_path, ufo.glifs.size(), seconds.count());
+  return 0;
+  }
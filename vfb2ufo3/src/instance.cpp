@@ -0,0 +1,225 @@
+// instance.cpp
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dump.cpp"
+#include "glif.cpp"
+#include "kern.cpp"
+#include "mark.cpp"
+
+// weight of each master at an instance, given one value per axis from 0 to
+// 1000; bit i of a master's index is its position on axis i, as in MATRIX in
+// includes/core.pxi, and its weight is the product of its linear weights on
+// each axis
+std::vector<double> master_weights(const std::vector<double> &values, size_t axes) {
+  std::vector<double> weights(1 << axes, 1.0);
+  for (size_t master = 0; master < weights.size(); master++)
+    for (size_t axis = 0; axis < axes; axis++) {
+      double t = axis < values.size() ? values[axis] / 1000.0 : 0.0;
+      weights[master] *= (master >> axis) & 1 ? t : 1.0 - t;
+      }
+  return weights;
+  }
+
+// weighted sum of a run of per-master values
+static inline double blend(const float *values, const std::vector<double> &weights) {
+  double value = 0.0;
+  for (size_t i = 0; i < weights.size(); i++)
+    value += weights[i] * values[i];
+  return value;
+  }
+
+// blended value rounded to the integer grid FontLab gives an instance
+static inline float blend_round(const float *values, const std::vector<double> &weights) {
+  return std::nearbyint(blend(values, weights));
+  }
+
+// builds the glifs of an instance from a dump as glifs() does from a FontLab
+// instance font; glif paths are placed under glyphs_path, everything is scaled
+// when scale is non-zero, and hints are only kept when ufo.hint_type is set;
+// the anchors of the instance are indexed into marks when given
+void build_ufo(const dump_reader &dump, const std::vector<double> &weights, cpp_ufo &ufo, const std::string &glyphs_path, float scale, char path_sep='/', cpp_marks *marks=nullptr) {
+  size_t masters = dump.header->masters;
+  const auto *glyphs = dump.records<dump_glyph>(DUMP_GLYPHS);
+  const auto *code_points = dump.records<std::uint32_t>(DUMP_CODE_POINTS);
+  const auto *contours = dump.records<dump_range>(DUMP_CONTOURS);
+  const auto *points = dump.records<dump_point>(DUMP_POINTS);
+  const auto *components = dump.records<dump_component>(DUMP_COMPONENTS);
+  const auto *anchors = dump.records<dump_anchor>(DUMP_ANCHORS);
+  const auto *hints = dump.records<dump_hint>(DUMP_HINTS);
+  const auto *replacements = dump.records<dump_replacement>(DUMP_REPLACEMENTS);
+
+  ufo.reserve(dump.count(DUMP_GLYPHS));
+  ufo.outlines.reserve(dump.count(DUMP_CONTOURS), dump.count(DUMP_POINTS));
+
+  for (size_t i = 0; i < dump.count(DUMP_GLYPHS); i++) {
+    const auto &glyph = glyphs[i];
+    bool has_hints = ufo.hint_type and glyph.hints;
+
+    size_t len_points = 0;
+    for (size_t c = glyph.contours.start; c < glyph.contours.end; c++)
+      len_points += contours[c].end - contours[c].start;
+
+    float width = blend_round(dump.values(glyph.width), weights);
+    if (scale)
+      width = (int) std::max(width * scale, 0.0f);
+
+    cpp_glif glif(
+      std::string(dump.str(glyph.name)),
+      glyphs_path + path_sep + std::string(dump.str(glyph.glif_name)),
+      glyph.mark,
+      width,
+      glyph.index,
+      len_points,
+      glyph.omit,
+      glyph.base
+      );
+
+    for (size_t j = glyph.code_points.start; j < glyph.code_points.end; j++)
+      glif.code_points.push_back(code_points[j]);
+
+    glif.anchors.reserve(glyph.anchors.end - glyph.anchors.start);
+    for (size_t j = glyph.anchors.start; j < glyph.anchors.end; j++) {
+      const float *values = dump.values(anchors[j].values);
+      glif.anchors.emplace_back(
+        std::string(dump.str(anchors[j].name)),
+        blend_round(values, weights),
+        blend_round(values + masters, weights));
+      }
+
+    glif.components.reserve(glyph.components.end - glyph.components.start);
+    for (size_t j = glyph.components.start; j < glyph.components.end; j++) {
+      const float *values = dump.values(components[j].values);
+      glif.components.emplace_back(
+        std::string(dump.str(components[j].base)),
+        components[j].index,
+        blend_round(values, weights),
+        blend_round(values + masters, weights),
+        blend(values + 2 * masters, weights),
+        blend(values + 3 * masters, weights));
+      }
+
+    if (has_hints) {
+      for (size_t j = glyph.vhints.start; j < glyph.vhints.end; j++) {
+        const float *values = dump.values(hints[j].values);
+        glif.vhints.emplace_back(blend_round(values, weights), blend_round(values + masters, weights), true, hints[j].ghost);
+        }
+      for (size_t j = glyph.hhints.start; j < glyph.hhints.end; j++) {
+        const float *values = dump.values(hints[j].values);
+        glif.hhints.emplace_back(blend_round(values, weights), blend_round(values + masters, weights), false, hints[j].ghost);
+        }
+      for (size_t j = glyph.replacements.start; j < glyph.replacements.end; j++)
+        glif.hint_replacements.emplace_back(replacements[j].type, replacements[j].index);
+      }
+
+    if (len_points) {
+      glif.outline.start = ufo.outlines.contours.size();
+      for (size_t c = glyph.contours.start; c < glyph.contours.end; c++) {
+        ufo.outlines.add_contour();
+        for (size_t j = contours[c].start; j < contours[c].end; j++) {
+          const auto &point = points[j];
+          const float *values = dump.values(point.values);
+          float x = blend_round(values, weights);
+          float y = blend_round(values + masters, weights);
+          if (has_hints and point.hintset != DUMP_NO_HINTSET)
+            ufo.outlines.add_point(x, y, point.type, point.smooth, point.hintset);
+          else
+            ufo.outlines.add_point(x, y, point.type, point.smooth);
+          }
+        }
+      glif.outline.end = ufo.outlines.contours.size();
+      ufo.contours[glif.index] = glif.outline;
+      }
+
+    ufo.glifs.push_back(std::move(glif));
+    }
+
+  // anchors are indexed in font units, before the glifs are scaled
+  if (marks)
+    marks->scan(ufo.glifs);
+
+  if (scale)
+    for (auto &glif : ufo.glifs)
+      glif.scale(scale, ufo.outlines);
+  }
+
+// kerning pairs of an instance, in the order they were dumped, with values as
+// kerning() takes them from a FontLab instance font
+std::vector<cpp_kern_pair> build_kerning(const dump_reader &dump, const std::vector<double> &weights, float scale) {
+  const auto *kerning = dump.records<dump_kern_pair>(DUMP_KERNING);
+  std::vector<cpp_kern_pair> pairs;
+  pairs.reserve(dump.count(DUMP_KERNING));
+  for (size_t i = 0; i < dump.count(DUMP_KERNING); i++) {
+    long value = blend_round(dump.values(kerning[i].values), weights);
+    if (scale)
+      value = value * scale;
+    pairs.push_back({kerning[i].first, kerning[i].second, value});
+    }
+  return pairs;
+  }
+
+// every instance of a font built from one dump of its masters; instances are
+// interpolated in parallel, one per thread, and released once written
+class cpp_instances {
+  public:
+  dump_reader dump;
+  std::vector<cpp_ufo> ufos;
+  std::vector<std::vector<cpp_kern_pair>> kerning;
+  std::vector<cpp_marks> marks;
+  std::string load(std::string data);
+  void build(
+    const std::vector<std::vector<double>> &values,
+    const std::vector<std::string> &glyphs_paths,
+    int hint_type,
+    bool ufoz,
+    float scale,
+    char path_sep,
+    const cpp_marks &marks
+    );
+  void release(size_t i);
+  };
+
+std::string cpp_instances::load(std::string data) {
+  return this->dump.load(std::move(data));
+  }
+
+void cpp_instances::build(
+    const std::vector<std::vector<double>> &values,
+    const std::vector<std::string> &glyphs_paths,
+    int hint_type,
+    bool ufoz,
+    float scale,
+    char path_sep,
+    const cpp_marks &marks
+    ) {
+  size_t n = values.size();
+  this->ufos.clear();
+  this->ufos.resize(n);
+  this->kerning.clear();
+  this->kerning.resize(n);
+  this->marks.assign(n, marks);
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for (size_t i = 0; i < n; i++) {
+    auto weights = master_weights(values[i], this->dump.header->axes);
+    auto &ufo = this->ufos[i];
+    ufo.hint_type = hint_type;
+    ufo.optimize = false;
+    ufo.ufoz = ufoz;
+    build_ufo(this->dump, weights, ufo, glyphs_paths[i], scale, path_sep, &this->marks[i]);
+    this->kerning[i] = build_kerning(this->dump, weights, scale);
+    }
+  }
+
+void cpp_instances::release(size_t i) {
+  this->ufos[i] = cpp_ufo();
+  std::vector<cpp_kern_pair>().swap(this->kerning[i]);
+  this->marks[i] = cpp_marks();
+  }
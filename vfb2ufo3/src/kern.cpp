@@ -0,0 +1,352 @@
+// kern.cpp
+
+#pragma once
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+#include <fmt/compile.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "plist.cpp"
+
+// class kerning is built as PairPos format 2 subtables: a 16 byte header and a
+// class1Count x class2Count matrix of 2 byte XAdvance value records, followed
+// by the coverage and the two class definitions; their offsets are 16 bit,
+// so each subtable is kept under 64 KB
+#define KERN_SUBTABLE_LIMIT 65535
+#define KERN_SUBTABLE_HEADER 16
+#define KERN_VALUE_RECORD 2
+
+// kerning pair of glyph indexes in the font, as interpolated or read from a
+// FontLab instance font
+struct cpp_kern_pair {
+  size_t first;
+  size_t second;
+  long value;
+  };
+
+#pragma pack(push, 1)
+
+// kerning pair of glyph ids; ids are the ranks of the glyph names, so pairs
+// sorted by id are in glyph name order
+struct cpp_kern_record {
+  std::uint32_t first;
+  std::uint32_t second;
+  std::int32_t value;
+  };
+
+#pragma pack(pop)
+
+// body of a kern feature; more than one class subtable calls for an extension
+// lookup, which the fea writer wraps around the lines, and each first group
+// in oversize has more class pairs than fit in one subtable on its own
+struct cpp_kern_feature {
+  std::string lines;
+  size_t subtables = 0;
+  std::vector<std::string> oversize;
+  };
+
+// the kerning of an instance
+//
+// pairs are added by glyph index and kept as packed records of glyph ids;
+// sort() orders them by first and second glyph name, as kerning() sorted
+// them, and each glyph is written as its kerning group on the side where it
+// is the key glyph of one; feature() writes the kern feature of the sorted
+// pairs
+class cpp_kerning {
+  public:
+  std::vector<cpp_kern_record> records;
+  void set_glyphs(
+    const std::vector<std::string> &names,
+    const std::vector<std::string> &firsts,
+    const std::vector<std::string> &seconds
+    );
+  void reserve(size_t n);
+  void add_pair(size_t first, size_t second, long value);
+  void add_pairs(const std::vector<cpp_kern_pair> &pairs);
+  void set_groups(
+    const std::vector<size_t> &first_sizes,
+    const std::vector<size_t> &second_sizes
+    );
+  void sort();
+  size_t size() const;
+  const std::string &first(const cpp_kern_record &record) const;
+  const std::string &second(const cpp_kern_record &record) const;
+  std::string plist() const;
+  cpp_kern_feature feature(long min_value) const;
+  private:
+  std::vector<std::uint32_t> ids;
+  std::vector<std::string> firsts;
+  std::vector<std::string> seconds;
+  std::vector<size_t> first_sizes;
+  std::vector<size_t> second_sizes;
+  };
+
+// names, firsts and seconds are given by glyph index; firsts and seconds are
+// the names a glyph is written as in each position of a pair
+void cpp_kerning::set_glyphs(
+    const std::vector<std::string> &names,
+    const std::vector<std::string> &firsts,
+    const std::vector<std::string> &seconds
+    ) {
+  std::vector<std::uint32_t> order(names.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+    [&names](std::uint32_t a, std::uint32_t b) { return names[a] < names[b]; });
+
+  this->ids.assign(names.size(), 0);
+  this->firsts.resize(names.size());
+  this->seconds.resize(names.size());
+  this->first_sizes.assign(names.size(), 0);
+  this->second_sizes.assign(names.size(), 0);
+  for (std::uint32_t id = 0; id < order.size(); id++) {
+    this->ids[order[id]] = id;
+    this->firsts[id] = firsts[order[id]];
+    this->seconds[id] = seconds[order[id]];
+    }
+  }
+
+void cpp_kerning::reserve(size_t n) {
+  this->records.reserve(n);
+  }
+
+void cpp_kerning::add_pair(size_t first, size_t second, long value) {
+  this->records.push_back({this->ids[first], this->ids[second], (std::int32_t) value});
+  }
+
+void cpp_kerning::add_pairs(const std::vector<cpp_kern_pair> &pairs) {
+  this->records.reserve(this->records.size() + pairs.size());
+  for (const auto &pair : pairs)
+    this->add_pair(pair.first, pair.second, pair.value);
+  }
+
+// sizes are given by glyph index: the number of glyphs in the kerning group a
+// glyph is the key glyph of on each side of a pair, or 0 where it is not one
+void cpp_kerning::set_groups(
+    const std::vector<size_t> &first_sizes,
+    const std::vector<size_t> &second_sizes
+    ) {
+  for (size_t i = 0; i < this->ids.size(); i++) {
+    this->first_sizes[this->ids[i]] = first_sizes[i];
+    this->second_sizes[this->ids[i]] = second_sizes[i];
+    }
+  }
+
+// stable least-significant-digit radix sort on the second and then the first
+// id, 16 bits per pass; a pair added more than once keeps its greatest value,
+// as _kerning() sorted each first's (second, value) pairs into a dict
+void cpp_kerning::sort() {
+  size_t n = this->records.size();
+  if (n < 2)
+    return;
+
+  std::uint32_t max_id = 0;
+  for (const auto &record : this->records)
+    max_id = std::max({max_id, record.first, record.second});
+
+  std::vector<cpp_kern_record> sorted(n);
+  std::vector<size_t> counts(1 << 16);
+  auto pass = [&](auto key, int shift) {
+    std::fill(counts.begin(), counts.end(), 0);
+    for (const auto &record : this->records)
+      counts[(key(record) >> shift) & 0xffff]++;
+    size_t offset = 0;
+    for (auto &count : counts) {
+      size_t start = offset;
+      offset += count;
+      count = start;
+      }
+    for (const auto &record : this->records)
+      sorted[counts[(key(record) >> shift) & 0xffff]++] = record;
+    this->records.swap(sorted);
+    };
+
+  auto second = [](const cpp_kern_record &record) { return record.second; };
+  auto first = [](const cpp_kern_record &record) { return record.first; };
+  for (int shift = 0; shift < 32 and (shift == 0 or max_id >> shift); shift += 16)
+    pass(second, shift);
+  for (int shift = 0; shift < 32 and (shift == 0 or max_id >> shift); shift += 16)
+    pass(first, shift);
+
+  // keep the greatest value of each run of equal pairs
+  size_t j = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (j and
+        this->records[j - 1].first == this->records[i].first and
+        this->records[j - 1].second == this->records[i].second) {
+      this->records[j - 1].value = std::max(this->records[j - 1].value, this->records[i].value);
+      continue;
+      }
+    this->records[j++] = this->records[i];
+    }
+  this->records.resize(j);
+  }
+
+size_t cpp_kerning::size() const {
+  return this->records.size();
+  }
+
+const std::string &cpp_kerning::first(const cpp_kern_record &record) const {
+  return this->firsts[record.first];
+  }
+
+const std::string &cpp_kerning::second(const cpp_kern_record &record) const {
+  return this->seconds[record.second];
+  }
+
+// kerning.plist of the sorted pairs, one dict of seconds for each first
+std::string cpp_kerning::plist() const {
+  cpp_plist plist;
+  plist.reserve(this->records.size() * 48 + 4096);
+  plist.begin_dict();
+  for (size_t i = 0; i < this->records.size(); i++) {
+    const auto &record = this->records[i];
+    if (i == 0 or record.first != this->records[i - 1].first) {
+      if (i)
+        plist.end_dict();
+      plist.add_key(this->first(record));
+      plist.begin_dict();
+      }
+    plist.add_key(this->second(record));
+    plist.add_integer(record.value);
+    }
+  if (this->records.size())
+    plist.end_dict();
+  plist.end_dict();
+  return plist.finish();
+  }
+
+// class pairs of one subtable; pairs of a first group are never split across
+// subtables, as a later subtable is not reached for a first glyph covered by
+// an earlier one
+struct kern_subtable {
+  std::vector<size_t> rows;
+  std::vector<bool> seconds;
+  size_t n_firsts = 0;
+  size_t n_seconds = 0;
+  size_t first_glyphs = 0;
+  size_t second_glyphs = 0;
+  };
+
+// upper bound of the size of a subtable; class 0 is counted in both class
+// counts, coverage is taken as format 1 and each class definition as format 2
+// with one range per glyph, the most either format can take
+static inline size_t kern_subtable_size(size_t n_firsts, size_t n_seconds, size_t first_glyphs, size_t second_glyphs) {
+  return KERN_SUBTABLE_HEADER +
+    (n_firsts + 1) * (n_seconds + 1) * KERN_VALUE_RECORD +
+    4 + 2 * first_glyphs +
+    4 + 6 * first_glyphs +
+    4 + 6 * second_glyphs;
+  }
+
+// body of the kern feature: glyph pairs, enumerated pairs of a group and a
+// glyph, and class pairs packed first-fit into as few subtables as fit under
+// KERN_SUBTABLE_LIMIT; pairs with an absolute value below min_value are left
+// out; a first group whose own pairs are over the limit still gets a single
+// subtable, as splitting it would drop the pairs of its later subtables, and
+// is reported in oversize
+cpp_kern_feature cpp_kerning::feature(long min_value) const {
+  cpp_kern_feature feature;
+  fmt::memory_buffer glyph_pairs, first_enums, second_enums;
+  std::vector<std::pair<size_t, size_t>> rows;
+  std::vector<cpp_kern_record> class_pairs;
+
+  for (const auto &record : this->records) {
+    if (std::abs((long) record.value) < min_value)
+      continue;
+    bool first_group = this->first_sizes[record.first];
+    bool second_group = this->second_sizes[record.second];
+    if (first_group and second_group) {
+      if (rows.empty() or class_pairs[rows.back().first].first != record.first)
+        rows.push_back({class_pairs.size(), class_pairs.size()});
+      class_pairs.push_back(record);
+      rows.back().second++;
+      }
+    else if (first_group)
+      fmt::format_to(std::back_inserter(first_enums), FMT_COMPILE("\tenum pos @{} {} {};\n"),
+        this->first(record), this->second(record), record.value);
+    else if (second_group)
+      fmt::format_to(std::back_inserter(second_enums), FMT_COMPILE("\tenum pos {} @{} {};\n"),
+        this->first(record), this->second(record), record.value);
+    else
+      fmt::format_to(std::back_inserter(glyph_pairs), FMT_COMPILE("\tpos {} {} {};\n"),
+        this->first(record), this->second(record), record.value);
+    }
+
+  std::vector<kern_subtable> subtables;
+  std::vector<std::uint32_t> new_seconds;
+  for (size_t row = 0; row < rows.size(); row++) {
+    auto [start, end] = rows[row];
+    kern_subtable *fit = nullptr;
+    size_t n_new = 0, new_glyphs = 0;
+    for (auto &subtable : subtables) {
+      n_new = new_glyphs = 0;
+      for (size_t i = start; i < end; i++)
+        if (not subtable.seconds[class_pairs[i].second]) {
+          n_new++;
+          new_glyphs += this->second_sizes[class_pairs[i].second];
+          }
+      size_t size = kern_subtable_size(
+        subtable.n_firsts + 1,
+        subtable.n_seconds + n_new,
+        subtable.first_glyphs + this->first_sizes[class_pairs[start].first],
+        subtable.second_glyphs + new_glyphs
+        );
+      if (size <= KERN_SUBTABLE_LIMIT) {
+        fit = &subtable;
+        break;
+        }
+      }
+    if (not fit) {
+      subtables.emplace_back();
+      fit = &subtables.back();
+      fit->seconds.assign(this->ids.size(), false);
+      n_new = end - start;
+      new_glyphs = 0;
+      for (size_t i = start; i < end; i++)
+        new_glyphs += this->second_sizes[class_pairs[i].second];
+      size_t size = kern_subtable_size(1, n_new, this->first_sizes[class_pairs[start].first], new_glyphs);
+      if (size > KERN_SUBTABLE_LIMIT)
+        feature.oversize.push_back(this->first(class_pairs[start]));
+      }
+    fit->rows.push_back(row);
+    fit->n_firsts++;
+    fit->n_seconds += n_new;
+    fit->first_glyphs += this->first_sizes[class_pairs[start].first];
+    fit->second_glyphs += new_glyphs;
+    for (size_t i = start; i < end; i++)
+      fit->seconds[class_pairs[i].second] = true;
+    }
+
+  fmt::memory_buffer buf;
+  append(buf, std::string_view(glyph_pairs.data(), glyph_pairs.size()));
+  if (first_enums.size())
+    append(first_enums, "\tsubtable;\n");
+  append(buf, std::string_view(first_enums.data(), first_enums.size()));
+  if (second_enums.size())
+    append(second_enums, "\tsubtable;\n");
+  append(buf, std::string_view(second_enums.data(), second_enums.size()));
+  for (size_t i = 0; i < subtables.size(); i++) {
+    if (i)
+      append(buf, "\tsubtable;\n");
+    for (auto row : subtables[i].rows)
+      for (size_t j = rows[row].first; j < rows[row].second; j++)
+        fmt::format_to(std::back_inserter(buf), FMT_COMPILE("\tpos @{} @{} {};\n"),
+          this->first(class_pairs[j]), this->second(class_pairs[j]), class_pairs[j].value);
+    }
+
+  if (buf.size())
+    buf.resize(buf.size() - 1);
+  feature.lines = fmt::to_string(buf);
+  feature.subtables = subtables.size();
+  return feature;
+  }
@@ -0,0 +1,132 @@
+// manifest.cpp
+
+#pragma once
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+#include <fmt/compile.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "zlib.h"
+
+#define MANIFEST_HEADER "vfb2ufo3 manifest 1"
+
+// crc-32 and size of a file as it was written
+struct manifest_entry {
+  std::uint32_t crc = 0;
+  std::uint64_t size = 0;
+  manifest_entry() {}
+  manifest_entry(std::string_view data) {
+    this->crc = crc32_z(0, (const unsigned char*)data.data(), data.size());
+    this->size = data.size();
+    }
+  bool operator==(const manifest_entry &other) const {
+    return this->crc == other.crc and this->size == other.size;
+    }
+  };
+
+// files written to an output on its previous run, and those written or kept
+// on this one
+//
+// a file is unchanged when its rendered crc-32 and size match the previous
+// run and the file on disk still has that size; unchanged files are left
+// untouched so their modification times are kept. finish() removes files of
+// the previous run that were not written again and replaces the manifest
+class cpp_manifest {
+  public:
+  std::string path;
+  size_t written = 0;
+  size_t skipped = 0;
+  cpp_manifest(const std::string &path);
+  bool unchanged(const std::string &path, const manifest_entry &entry) const;
+  void add(const std::string &path, const manifest_entry &entry, bool written);
+  std::vector<std::string> finish();
+  private:
+  std::unordered_map<std::string, manifest_entry> previous;
+  std::unordered_map<std::string, manifest_entry> current;
+  };
+
+// a missing or unreadable manifest leaves every file to be written
+cpp_manifest::cpp_manifest(const std::string &path) {
+  this->path = path;
+  std::ifstream file(path, std::ios::binary);
+  std::string line;
+  if (not std::getline(file, line) or line != MANIFEST_HEADER)
+    return;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    manifest_entry entry;
+    std::string file_path;
+    fields >> std::hex >> entry.crc >> std::dec >> entry.size;
+    if (fields.get() != ' ' or not std::getline(fields, file_path))
+      continue;
+    this->previous[file_path] = entry;
+    }
+  }
+
+// safe to call from several threads while no files are added
+bool cpp_manifest::unchanged(const std::string &path, const manifest_entry &entry) const {
+  auto previous = this->previous.find(path);
+  if (previous == this->previous.end() or not (previous->second == entry))
+    return false;
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0 and (std::uint64_t) st.st_size == entry.size;
+  }
+
+void cpp_manifest::add(const std::string &path, const manifest_entry &entry, bool written) {
+  this->current[path] = entry;
+  if (written)
+    this->written++;
+  else
+    this->skipped++;
+  }
+
+// returns a message for each file that could not be removed and for the
+// manifest if it could not be written
+std::vector<std::string> cpp_manifest::finish() {
+  std::vector<std::string> errors;
+  for (const auto &[path, entry] : this->previous)
+    if (not this->current.count(path)) {
+      struct stat st;
+      if (::stat(path.c_str(), &st) == 0 and std::remove(path.c_str()) != 0)
+        errors.push_back(path + ": " + std::strerror(errno));
+      }
+
+  std::vector<const std::string*> paths;
+  paths.reserve(this->current.size());
+  for (const auto &[path, entry] : this->current)
+    paths.push_back(&path);
+  std::sort(paths.begin(), paths.end(), [](auto a, auto b) { return *a < *b; });
+
+  fmt::memory_buffer buf;
+  fmt::format_to(std::back_inserter(buf), FMT_COMPILE("{}\n"), MANIFEST_HEADER);
+  for (auto path : paths) {
+    const auto &entry = this->current[*path];
+    fmt::format_to(std::back_inserter(buf), FMT_COMPILE("{:08x} {} {}\n"), entry.crc, entry.size, *path);
+    }
+
+  std::ofstream file(this->path, std::ios::binary | std::ios::trunc);
+  file.write(buf.data(), buf.size());
+  file.close();
+  if (not file)
+    errors.push_back(this->path + ": manifest could not be written");
+
+  this->previous = std::move(this->current);
+  this->current.clear();
+  return errors;
+  }
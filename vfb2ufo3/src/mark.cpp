@@ -0,0 +1,187 @@
+// mark.cpp
+
+#pragma once
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+#include <fmt/compile.h>
+
+#include <omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glif.cpp"
+
+// anchor of a glyph in whole font units, before the instance is scaled;
+// glyph is the position of its glif in the instance
+struct cpp_mark_anchor {
+  std::uint32_t glyph;
+  std::int32_t x;
+  std::int32_t y;
+  };
+
+// anchors of an instance indexed by anchor name id
+//
+// ids are the ranks of the mark class names given to set_anchors(); scan()
+// adds the anchors of the glifs of an instance before they are scaled, and
+// feature() writes the mark feature from them as _mark_feature() in mark.pyx
+// wrote it from the anchors of the FontLab instance font, with each base
+// anchor name in its own lookup
+class cpp_marks {
+  public:
+  void set_anchors(const std::vector<std::string> &mark_classes, const std::vector<std::string> &bases);
+  void scan(const std::vector<cpp_glif> &glifs);
+  std::string feature(double scale) const;
+  private:
+  std::vector<std::string> names;
+  std::vector<bool> bases;
+  std::unordered_map<std::string, std::uint32_t> ids;
+  std::vector<std::string> glyphs;
+  std::vector<std::vector<cpp_mark_anchor>> mark_anchors;
+  std::vector<std::vector<cpp_mark_anchor>> base_anchors;
+  };
+
+// mark classes are the names of mark anchors without their leading
+// underscore; bases are the names of base anchors that have a lookup
+void cpp_marks::set_anchors(const std::vector<std::string> &mark_classes, const std::vector<std::string> &bases) {
+  this->names = mark_classes;
+  std::sort(this->names.begin(), this->names.end());
+  this->names.erase(std::unique(this->names.begin(), this->names.end()), this->names.end());
+
+  this->ids.clear();
+  this->bases.assign(this->names.size(), false);
+  for (std::uint32_t id = 0; id < this->names.size(); id++) {
+    this->ids[this->names[id]] = id;
+    this->bases[id] = std::find(bases.begin(), bases.end(), this->names[id]) != bases.end();
+    }
+  }
+
+// each thread indexes a static run of glifs, and the runs are joined in glif
+// order; glifs of omitted glyphs are skipped
+void cpp_marks::scan(const std::vector<cpp_glif> &glifs) {
+  size_t n_names = this->names.size();
+  this->glyphs.assign(glifs.size(), std::string());
+  this->mark_anchors.assign(n_names, {});
+  this->base_anchors.assign(n_names, {});
+  if (not n_names)
+    return;
+
+  using anchor_runs = std::vector<std::vector<cpp_mark_anchor>>;
+  std::vector<anchor_runs> thread_marks(omp_get_max_threads(), anchor_runs(n_names));
+  std::vector<anchor_runs> thread_bases(omp_get_max_threads(), anchor_runs(n_names));
+
+  #pragma omp parallel
+  {
+    auto &marks = thread_marks[omp_get_thread_num()];
+    auto &bases = thread_bases[omp_get_thread_num()];
+    #pragma omp for schedule(static)
+    for (size_t i = 0; i < glifs.size(); i++) {
+      const auto &glif = glifs[i];
+      if (glif.omit or glif.anchors.empty())
+        continue;
+      bool found = false;
+      for (const auto &anchor : glif.anchors) {
+        if (anchor.name.empty())
+          continue;
+        cpp_mark_anchor record = {(std::uint32_t) i, (std::int32_t) anchor.x, (std::int32_t) anchor.y};
+        if (anchor.name[0] == '_') {
+          auto id = this->ids.find(anchor.name.substr(1));
+          if (id != this->ids.end()) {
+            marks[id->second].push_back(record);
+            found = true;
+            continue;
+            }
+          }
+        auto id = this->ids.find(anchor.name);
+        if (id != this->ids.end()) {
+          bases[id->second].push_back(record);
+          found = true;
+          }
+        }
+      if (found)
+        this->glyphs[i] = glif.name;
+      }
+  }
+
+  for (size_t t = 0; t < thread_marks.size(); t++)
+    for (size_t id = 0; id < n_names; id++) {
+      auto &marks = thread_marks[t][id];
+      auto &bases = thread_bases[t][id];
+      this->mark_anchors[id].insert(this->mark_anchors[id].end(), marks.begin(), marks.end());
+      this->base_anchors[id].insert(this->base_anchors[id].end(), bases.begin(), bases.end());
+      }
+  }
+
+// body of the mark feature: the sorted mark classes, one lookup of sorted
+// base positions for each base anchor name with bases, in name order, and
+// the lookup references; empty when there are no bases
+//
+// coordinates are scaled from whole font units and rounded to nearest, and
+// the lookups are written in parallel
+std::string cpp_marks::feature(double scale) const {
+  std::vector<std::uint32_t> lookups;
+  for (std::uint32_t id = 0; id < this->names.size(); id++)
+    if (this->bases[id] and this->base_anchors[id].size())
+      lookups.push_back(id);
+  if (lookups.empty())
+    return std::string();
+
+  auto coord = [scale](std::int32_t value) { return (long) std::nearbyint(value * scale); };
+  std::vector<std::vector<std::string>> classes(this->names.size());
+  std::vector<std::string> texts(lookups.size());
+
+  #pragma omp parallel
+  {
+    #pragma omp for schedule(dynamic, 1) nowait
+    for (size_t id = 0; id < this->names.size(); id++)
+      for (const auto &anchor : this->mark_anchors[id])
+        classes[id].push_back(fmt::format(FMT_COMPILE("\tmarkClass {} <anchor {} {}> @{};"),
+          this->glyphs[anchor.glyph], coord(anchor.x), coord(anchor.y), this->names[id]));
+
+    #pragma omp for schedule(dynamic, 1)
+    for (size_t i = 0; i < lookups.size(); i++) {
+      const auto &name = this->names[lookups[i]];
+      std::vector<std::string> lines;
+      lines.reserve(this->base_anchors[lookups[i]].size());
+      for (const auto &anchor : this->base_anchors[lookups[i]])
+        lines.push_back(fmt::format(FMT_COMPILE("\t\tpos base {} <anchor {} {}> mark @{};"),
+          this->glyphs[anchor.glyph], coord(anchor.x), coord(anchor.y), name));
+      std::sort(lines.begin(), lines.end());
+
+      fmt::memory_buffer buf;
+      fmt::format_to(std::back_inserter(buf), FMT_COMPILE("\tlookup mark{} {{\n"), i + 1);
+      for (const auto &line : lines) {
+        append(buf, line);
+        buf.push_back('\n');
+        }
+      fmt::format_to(std::back_inserter(buf), FMT_COMPILE("\t}} mark{};"), i + 1);
+      texts[i] = fmt::to_string(buf);
+      }
+  }
+
+  std::vector<std::string> mark_classes;
+  for (auto &lines : classes)
+    mark_classes.insert(mark_classes.end(), lines.begin(), lines.end());
+  std::sort(mark_classes.begin(), mark_classes.end());
+  mark_classes.erase(std::unique(mark_classes.begin(), mark_classes.end()), mark_classes.end());
+
+  fmt::memory_buffer buf;
+  for (size_t i = 0; i < mark_classes.size(); i++) {
+    if (i)
+      buf.push_back('\n');
+    append(buf, mark_classes[i]);
+    }
+  for (const auto &text : texts) {
+    buf.push_back('\n');
+    append(buf, text);
+    }
+  for (size_t i = 0; i < lookups.size(); i++)
+    fmt::format_to(std::back_inserter(buf), FMT_COMPILE("\n\tlookup mark{};"), i + 1);
+  return fmt::to_string(buf);
+  }
@@ -0,0 +1,279 @@
+// output.cpp
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "manifest.cpp"
+#include "schedule.cpp"
+
+#ifdef FILE_IO_URING
+#include "uring.cpp"
+#endif
+
+// files added to a file_writer are written once this many are pending, and
+// with io_uring, up to this many requests are submitted at a time
+#define OUTPUT_BATCH_SIZE (1024)
+#define OUTPUT_QUEUE_DEPTH (256)
+
+// files are opened in binary mode where that differs from text mode, so glifs
+// and plists keep their LF line endings on Windows and the size on disk is
+// the size of data, as the manifest expects
+#ifdef O_BINARY
+#define OUTPUT_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC | O_BINARY)
+#else
+#define OUTPUT_OPEN_FLAGS (O_WRONLY | O_CREAT | O_TRUNC)
+#endif
+
+// whole file waiting to be written, and the errno of its write if it failed;
+// data is owned by the file_writer or by the arena the file was rendered into
+struct output_file {
+  std::string path;
+  std::string_view data;
+  int error = 0;
+  output_file() {}
+  output_file(const std::string &path, std::string_view data) : path(path), data(data) {}
+  };
+
+// writes data to fd with pwrite from offset onwards, retrying short writes
+int write_fd(int fd, std::string_view data, size_t offset=0) {
+  while (offset < data.size()) {
+    ssize_t written = ::pwrite(fd, data.data() + offset, data.size() - offset, offset);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno;
+      }
+    offset += written;
+    }
+  return 0;
+  }
+
+// open/pwrite/close with plain syscalls; returns errno, or 0 on success
+int write_output_file(const std::string &path, std::string_view data) {
+  int fd = ::open(path.c_str(), OUTPUT_OPEN_FLAGS, 0666);
+  if (fd < 0)
+    return errno;
+  int error = write_fd(fd, data);
+  if (::close(fd) < 0 and not error)
+    error = errno;
+  return error;
+  }
+
+// batches whole rendered files and writes them with io_uring when compiled
+// with FILE_IO_URING on Linux and supported by the kernel, or with one
+// open/pwrite/close per file spread across threads otherwise; with a
+// manifest, files unchanged since the previous run are not written
+class file_writer {
+  public:
+  std::vector<output_file> files;
+  std::vector<std::string> errors;
+  cpp_manifest *manifest = nullptr;
+  file_writer();
+  ~file_writer();
+  file_writer(const file_writer&) = delete;
+  file_writer &operator=(const file_writer&) = delete;
+  void add(const std::string &path, std::string &&data);
+  void add(const std::string &path, std::string_view data);
+  void flush();
+#ifdef FILE_IO_URING
+  bool uring = false;
+#endif
+  private:
+  std::deque<std::string> owned;
+  std::vector<manifest_entry> skip_unchanged();
+  void flush_syscalls();
+#ifdef FILE_IO_URING
+  io_ring ring;
+  void flush_uring();
+  int submit(const std::vector<size_t> &pending, auto prepare, auto complete);
+#endif
+  };
+
+file_writer::file_writer() {
+#ifdef FILE_IO_URING
+  this->uring = this->ring.open(OUTPUT_QUEUE_DEPTH, {IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE});
+#endif
+  }
+
+file_writer::~file_writer() {
+  this->flush();
+  }
+
+void file_writer::add(const std::string &path, std::string &&data) {
+  this->add(path, this->owned.emplace_back(std::move(data)));
+  }
+
+// data is not copied and must stay valid until the file is flushed
+void file_writer::add(const std::string &path, std::string_view data) {
+  this->files.emplace_back(path, data);
+  if (this->files.size() >= OUTPUT_BATCH_SIZE)
+    this->flush();
+  }
+
+// drops the files the manifest has as unchanged and returns the entries of
+// the files left to write
+std::vector<manifest_entry> file_writer::skip_unchanged() {
+  std::vector<manifest_entry> entries(this->files.size());
+  std::vector<char> unchanged(this->files.size());
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t i = 0; i < this->files.size(); i++) {
+    entries[i] = manifest_entry(this->files[i].data);
+    unchanged[i] = this->manifest->unchanged(this->files[i].path, entries[i]);
+    }
+
+  size_t n = 0;
+  for (size_t i = 0; i < this->files.size(); i++) {
+    if (unchanged[i]) {
+      this->manifest->add(this->files[i].path, entries[i], false);
+      continue;
+      }
+    if (n != i) {
+      this->files[n] = std::move(this->files[i]);
+      entries[n] = entries[i];
+      }
+    n++;
+    }
+  this->files.resize(n);
+  entries.resize(n);
+  return entries;
+  }
+
+void file_writer::flush() {
+  std::vector<manifest_entry> entries;
+  if (this->manifest)
+    entries = this->skip_unchanged();
+  if (this->files.empty()) {
+    this->owned.clear();
+    return;
+    }
+
+#ifdef FILE_IO_URING
+  if (this->uring)
+    this->flush_uring();
+  else
+    this->flush_syscalls();
+#else
+  this->flush_syscalls();
+#endif
+
+  for (size_t i = 0; i < this->files.size(); i++) {
+    const auto &file = this->files[i];
+    if (file.error)
+      this->errors.push_back(file.path + ": " + std::strerror(file.error));
+    else if (this->manifest)
+      this->manifest->add(file.path, entries[i], true);
+    }
+  this->files.clear();
+  this->owned.clear();
+  }
+
+void file_writer::flush_syscalls() {
+  auto order = cost_order(this->files.size(), [this](size_t i) { return this->files[i].data.size(); });
+  run_ordered(order, [this](size_t i) {
+    this->files[i].error = write_output_file(this->files[i].path, this->files[i].data);
+    });
+  }
+
+#ifdef FILE_IO_URING
+
+// queues a request for each pending file, a ring's depth at a time, and hands
+// the index and result of each completion to complete; returns 0, or the
+// errno of a failed submission
+int file_writer::submit(const std::vector<size_t> &pending, auto prepare, auto complete) {
+  for (size_t start = 0; start < pending.size(); start += this->ring.depth()) {
+    size_t end = std::min(start + this->ring.depth(), pending.size());
+    for (size_t i = start; i < end; i++) {
+      io_uring_sqe *sqe = this->ring.get_sqe();
+      prepare(sqe, pending[i]);
+      sqe->user_data = pending[i];
+      }
+    int error = this->ring.submit([&complete](std::uint64_t i, int result) { complete(i, result); });
+    if (error)
+      return error;
+    }
+  return 0;
+  }
+
+// opens, writes and closes the batch as three rounds of requests; a short
+// write is finished with pwrite. if the ring fails, the files not yet closed
+// are given its error, and later batches are written with plain syscalls
+void file_writer::flush_uring() {
+  std::vector<int> fds(this->files.size(), -1);
+  std::vector<char> closed(this->files.size());
+  std::vector<size_t> pending(this->files.size());
+  std::iota(pending.begin(), pending.end(), 0);
+
+  int error = this->submit(pending,
+    [this](io_uring_sqe *sqe, size_t i) {
+      sqe->opcode = IORING_OP_OPENAT;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (std::uint64_t) this->files[i].path.c_str();
+      sqe->len = 0666;
+      sqe->open_flags = OUTPUT_OPEN_FLAGS;
+      },
+    [this, &fds](size_t i, int result) {
+      if (result < 0)
+        this->files[i].error = -result;
+      else
+        fds[i] = result;
+      });
+
+  pending.clear();
+  for (size_t i = 0; i < fds.size(); i++)
+    if (fds[i] >= 0)
+      pending.push_back(i);
+
+  if (not error)
+    error = this->submit(pending,
+      [this, &fds](io_uring_sqe *sqe, size_t i) {
+        sqe->opcode = IORING_OP_WRITE;
+        sqe->fd = fds[i];
+        sqe->addr = (std::uint64_t) this->files[i].data.data();
+        sqe->len = this->files[i].data.size();
+        sqe->off = 0;
+        },
+      [this, &fds](size_t i, int result) {
+        if (result < 0)
+          this->files[i].error = -result;
+        else if ((size_t) result < this->files[i].data.size())
+          this->files[i].error = write_fd(fds[i], this->files[i].data, result);
+        });
+
+  if (not error)
+    error = this->submit(pending,
+      [&fds](io_uring_sqe *sqe, size_t i) {
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fds[i];
+        },
+      [this, &closed](size_t i, int result) {
+        closed[i] = true;
+        if (result < 0 and not this->files[i].error)
+          this->files[i].error = -result;
+        });
+
+  if (not error)
+    return;
+  this->uring = false;
+  this->ring.close();
+  for (size_t i = 0; i < this->files.size(); i++) {
+    if (closed[i])
+      continue;
+    if (fds[i] >= 0)
+      ::close(fds[i]);
+    if (not this->files[i].error)
+      this->files[i].error = error;
+    }
+  }
+
+#endif
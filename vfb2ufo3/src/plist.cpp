@@ -0,0 +1,169 @@
+// plist.cpp
+
+#pragma once
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+#include <fmt/compile.h>
+
+#include <cmath>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string.cpp"
+
+#define PLIST_HEADER \
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" \
+  "<!DOCTYPE plist PUBLIC \"-//Apple Computer//DTD PLIST 1.0//EN\"\n" \
+  "\t\"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n" \
+  "<plist version=\"1.0\">\n"
+#define PLIST_FOOTER "</plist>\n"
+
+// streaming plist writer
+//
+// values are written in document order into one buffer, laid out as
+// plist_doc() in includes/xml.pxi lays them out: one element per line,
+// indented by tabs, and empty arrays on one line; keys and strings are
+// escaped
+class cpp_plist {
+  public:
+  cpp_plist();
+  void reserve(size_t n);
+  void begin_dict();
+  void end_dict();
+  void begin_array();
+  void end_array();
+  void add_key(std::string_view key);
+  void add_string(std::string_view value);
+  void add_integer(long value);
+  void add_real(double value);
+  void add_bool(bool value);
+  std::string finish();
+  private:
+  fmt::memory_buffer buf;
+  std::vector<bool> empty;
+  void open_elem();
+  void indent();
+  void text_elem(std::string_view tag, std::string_view text, bool escape=false);
+  };
+
+cpp_plist::cpp_plist() {
+  append(this->buf, PLIST_HEADER);
+  }
+
+void cpp_plist::reserve(size_t n) {
+  this->buf.reserve(n);
+  }
+
+// ends the opening tag of the enclosing container before its first element
+void cpp_plist::open_elem() {
+  if (this->empty.size() and this->empty.back()) {
+    this->buf.push_back('\n');
+    this->empty.back() = false;
+    }
+  }
+
+void cpp_plist::indent() {
+  for (size_t i = 0; i < this->empty.size(); i++)
+    this->buf.push_back('\t');
+  }
+
+static inline void xml_escape(fmt::memory_buffer &buf, std::string_view text) {
+  size_t start = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    const char *entity = nullptr;
+    switch (text[i]) {
+      case '&': entity = "&amp;"; break;
+      case '<': entity = "&lt;"; break;
+      case '>': entity = "&gt;"; break;
+      default: continue;
+      }
+    buf.append(text.data() + start, text.data() + i);
+    append(buf, entity);
+    start = i + 1;
+    }
+  buf.append(text.data() + start, text.data() + text.size());
+  }
+
+void cpp_plist::text_elem(std::string_view tag, std::string_view text, bool escape) {
+  this->open_elem();
+  this->indent();
+  fmt::format_to(std::back_inserter(this->buf), FMT_COMPILE("<{}>"), tag);
+  if (escape)
+    xml_escape(this->buf, text);
+  else
+    append(this->buf, text);
+  fmt::format_to(std::back_inserter(this->buf), FMT_COMPILE("</{}>\n"), tag);
+  }
+
+void cpp_plist::begin_dict() {
+  this->open_elem();
+  this->indent();
+  append(this->buf, "<dict>");
+  this->empty.push_back(true);
+  }
+
+// an empty dict is closed on the next line
+void cpp_plist::end_dict() {
+  this->open_elem();
+  this->empty.pop_back();
+  this->indent();
+  append(this->buf, "</dict>\n");
+  }
+
+void cpp_plist::begin_array() {
+  this->open_elem();
+  this->indent();
+  append(this->buf, "<array>");
+  this->empty.push_back(true);
+  }
+
+// an empty array is closed on the same line
+void cpp_plist::end_array() {
+  if (this->empty.back()) {
+    this->empty.pop_back();
+    append(this->buf, "</array>\n");
+    return;
+    }
+  this->empty.pop_back();
+  this->indent();
+  append(this->buf, "</array>\n");
+  }
+
+void cpp_plist::add_key(std::string_view key) {
+  this->text_elem("key", key, true);
+  }
+
+void cpp_plist::add_string(std::string_view value) {
+  this->text_elem("string", value, true);
+  }
+
+void cpp_plist::add_integer(long value) {
+  fmt::format_int text(value);
+  this->text_elem("integer", std::string_view(text.data(), text.size()));
+  }
+
+// reals are written as Python 2 str() writes floats: 12 significant digits,
+// with a trailing .0 for integral values
+void cpp_plist::add_real(double value) {
+  fmt::memory_buffer text;
+  fmt::format_to(std::back_inserter(text), FMT_COMPILE("{:.12g}"), value);
+  std::string_view str(text.data(), text.size());
+  if (std::isfinite(value) and str.find_first_of(".e") == std::string_view::npos)
+    append(text, ".0");
+  this->text_elem("real", std::string_view(text.data(), text.size()));
+  }
+
+void cpp_plist::add_bool(bool value) {
+  this->open_elem();
+  this->indent();
+  append(this->buf, value ? "<true/>\n" : "<false/>\n");
+  }
+
+// closes the document and hands over the buffer
+std::string cpp_plist::finish() {
+  append(this->buf, PLIST_FOOTER);
+  return fmt::to_string(this->buf);
+  }
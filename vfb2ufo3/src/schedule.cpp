@@ -0,0 +1,68 @@
+// schedule.cpp
+
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include <omp.h>
+
+// seconds each thread spent on items and waiting for the rest of the team,
+// and the number of items it ran
+struct thread_times {
+  std::vector<double> busy;
+  std::vector<double> idle;
+  std::vector<size_t> items;
+  };
+
+// item indices ordered by descending cost
+std::vector<size_t> cost_order(size_t n, auto cost) {
+  std::vector<size_t> costs(n);
+  std::vector<size_t> order(n);
+  for (size_t i = 0; i < n; i++)
+    costs[i] = cost(i);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+    [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+  return order;
+  }
+
+// runs task for each index in order, most expensive first, handing items to
+// threads as they become free so a few large items do not hold up the team;
+// thread times are added to any already in times
+void run_ordered(const std::vector<size_t> &order, auto task, thread_times *times=nullptr) {
+  std::vector<double> busy(omp_get_max_threads(), 0.0);
+  std::vector<size_t> items(busy.size(), 0);
+
+  double start = omp_get_wtime();
+  #pragma omp parallel
+  {
+    size_t thread = omp_get_thread_num();
+    double thread_busy = 0.0;
+    size_t thread_items = 0;
+
+    #pragma omp for schedule(dynamic) nowait
+    for (size_t i = 0; i < order.size(); i++) {
+      double item_start = omp_get_wtime();
+      task(order[i]);
+      thread_busy += omp_get_wtime() - item_start;
+      thread_items++;
+      }
+
+    busy[thread] = thread_busy;
+    items[thread] = thread_items;
+  }
+  double elapsed = omp_get_wtime() - start;
+
+  if (not times)
+    return;
+  times->busy.resize(busy.size(), 0.0);
+  times->idle.resize(busy.size(), 0.0);
+  times->items.resize(busy.size(), 0);
+  for (size_t i = 0; i < busy.size(); i++) {
+    times->busy[i] += busy[i];
+    times->idle[i] += std::max(elapsed - busy[i], 0.0);
+    times->items[i] += items[i];
+    }
+  }
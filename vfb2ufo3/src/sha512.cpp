@@ -44,6 +44,18 @@ SUCH DAMAGE.
 
 #include "sha512.hpp"
 
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <vector>
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+#define SHA512_X86
+#define SHA512_AVX2 __attribute__((target("avx2")))
+#define SHA512_AVX512 __attribute__((target("avx512f")))
+#include <immintrin.h>
+#endif
+
 namespace sha512 {
 
 typedef unsigned char byte;
@@ -109,7 +121,7 @@ std::string sha512::str() {
   std::string out;
   out.reserve(130);
   for (size_t i = 0; i < 8; i++)
-    out += fmt::format(FMT_COMPILE("{:016x}"), this->h[i]);
+    fmt::format_to(std::back_inserter(out), FMT_COMPILE("{:016x}"), this->h[i]);
   return out;
   }
 
@@ -191,4 +203,274 @@ std::string hash(const std::string &input) {
   return context.str();
   }
 
+
+// multi-lane hashing
+//
+// several messages are hashed at once, one 64-bit lane of a vector register
+// per message: 8 lanes with AVX-512 and 4 with AVX2, chosen when first used.
+// messages are read into their lanes a block at a time, so they need not be
+// held in memory whole, and a lane takes the next message as soon as its
+// last one is finished
+
+static const size_t MAX_LANES = 8;
+static const std::array<std::uint64_t, 8> H0 = {
+  0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+  0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+  };
+
+// pads the last len bytes of a message of message_len bytes as finish()
+// does; returns the number of blocks to transform, 1 or 2
+static size_t pad(byte *blocks, size_t len, std::uint32_t message_len) {
+  size_t block_nb = 1 + ((BLOCK_SIZE - 17) < len);
+  std::memset(blocks + len, 0, (block_nb << 7) - len);
+  blocks[len] = 0x80;
+  unpack32(message_len << 3, blocks + (block_nb << 7) - 4);
+  return block_nb;
+  }
+
+std::string digest_str(const std::uint64_t *h) {
+  std::string out;
+  out.reserve(130);
+  for (size_t i = 0; i < 8; i++)
+    fmt::format_to(std::back_inserter(out), FMT_COMPILE("{:016x}"), h[i]);
+  return out;
+  }
+
+#ifdef SHA512_X86
+
+template<int n> SHA512_AVX2 static inline __m256i rotr_avx2(__m256i x) {
+  return _mm256_or_si256(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n));
+  }
+SHA512_AVX2 static inline __m256i add_avx2(__m256i x, __m256i y) {
+  return _mm256_add_epi64(x, y);
+  }
+
+// one block of each of 4 messages; state holds word i of lane l at [i * 4 + l]
+SHA512_AVX2 static void transform_avx2(std::uint64_t *state, const byte *const *blocks) {
+  __m256i k[80], h[8];
+
+  for (size_t j = 0; j < 16; j++) {
+    alignas(32) std::uint64_t words[4];
+    for (size_t l = 0; l < 4; l++)
+      pack64(&blocks[l][j << 3], &words[l]);
+    k[j] = _mm256_load_si256((const __m256i*) words);
+    }
+  for (size_t j = 16; j < 80; j++) {
+    __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr_avx2<1>(k[j - 15]), rotr_avx2<8>(k[j - 15])), _mm256_srli_epi64(k[j - 15], 7));
+    __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr_avx2<19>(k[j - 2]), rotr_avx2<61>(k[j - 2])), _mm256_srli_epi64(k[j - 2], 6));
+    k[j] = add_avx2(add_avx2(s1, k[j - 7]), add_avx2(s0, k[j - 16]));
+    }
+
+  for (size_t i = 0; i < 8; i++)
+    h[i] = _mm256_loadu_si256((const __m256i*) &state[i * 4]);
+
+  for (size_t j = 0; j < 80; j++) {
+    __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(rotr_avx2<14>(h[4]), rotr_avx2<18>(h[4])), rotr_avx2<41>(h[4]));
+    __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(rotr_avx2<28>(h[0]), rotr_avx2<34>(h[0])), rotr_avx2<39>(h[0]));
+    __m256i ch = _mm256_xor_si256(_mm256_and_si256(h[4], h[5]), _mm256_andnot_si256(h[4], h[6]));
+    __m256i maj = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(h[0], h[1]), _mm256_and_si256(h[0], h[2])), _mm256_and_si256(h[1], h[2]));
+    __m256i t1 = add_avx2(add_avx2(add_avx2(h[7], S1), add_avx2(ch, _mm256_set1_epi64x(K[j]))), k[j]);
+    __m256i t2 = add_avx2(S0, maj);
+    h[7] = h[6];
+    h[6] = h[5];
+    h[5] = h[4];
+    h[4] = add_avx2(h[3], t1);
+    h[3] = h[2];
+    h[2] = h[1];
+    h[1] = h[0];
+    h[0] = add_avx2(t1, t2);
+    }
+
+  for (size_t i = 0; i < 8; i++)
+    _mm256_storeu_si256((__m256i*) &state[i * 4], add_avx2(_mm256_loadu_si256((const __m256i*) &state[i * 4]), h[i]));
+  }
+
+// one block of each of 8 messages; state holds word i of lane l at [i * 8 + l]
+SHA512_AVX512 static void transform_avx512(std::uint64_t *state, const byte *const *blocks) {
+  __m512i k[80], h[8];
+
+  for (size_t j = 0; j < 16; j++) {
+    alignas(64) std::uint64_t words[8];
+    for (size_t l = 0; l < 8; l++)
+      pack64(&blocks[l][j << 3], &words[l]);
+    k[j] = _mm512_load_si512((const void*) words);
+    }
+  for (size_t j = 16; j < 80; j++) {
+    __m512i s0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_ror_epi64(k[j - 15], 1), _mm512_ror_epi64(k[j - 15], 8)), _mm512_srli_epi64(k[j - 15], 7));
+    __m512i s1 = _mm512_xor_si512(_mm512_xor_si512(_mm512_ror_epi64(k[j - 2], 19), _mm512_ror_epi64(k[j - 2], 61)), _mm512_srli_epi64(k[j - 2], 6));
+    k[j] = _mm512_add_epi64(_mm512_add_epi64(s1, k[j - 7]), _mm512_add_epi64(s0, k[j - 16]));
+    }
+
+  for (size_t i = 0; i < 8; i++)
+    h[i] = _mm512_loadu_si512((const void*) &state[i * 8]);
+
+  for (size_t j = 0; j < 80; j++) {
+    __m512i S1 = _mm512_xor_si512(_mm512_xor_si512(_mm512_ror_epi64(h[4], 14), _mm512_ror_epi64(h[4], 18)), _mm512_ror_epi64(h[4], 41));
+    __m512i S0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_ror_epi64(h[0], 28), _mm512_ror_epi64(h[0], 34)), _mm512_ror_epi64(h[0], 39));
+    // ternary logic immediates: 0xca is ch(x, y, z), 0xe8 is maj(x, y, z)
+    __m512i ch = _mm512_ternarylogic_epi64(h[4], h[5], h[6], 0xca);
+    __m512i maj = _mm512_ternarylogic_epi64(h[0], h[1], h[2], 0xe8);
+    __m512i t1 = _mm512_add_epi64(_mm512_add_epi64(_mm512_add_epi64(h[7], S1), _mm512_add_epi64(ch, _mm512_set1_epi64(K[j]))), k[j]);
+    __m512i t2 = _mm512_add_epi64(S0, maj);
+    h[7] = h[6];
+    h[6] = h[5];
+    h[5] = h[4];
+    h[4] = _mm512_add_epi64(h[3], t1);
+    h[3] = h[2];
+    h[2] = h[1];
+    h[1] = h[0];
+    h[0] = _mm512_add_epi64(t1, t2);
+    }
+
+  for (size_t i = 0; i < 8; i++)
+    _mm512_storeu_si512((void*) &state[i * 8], _mm512_add_epi64(_mm512_loadu_si512((const void*) &state[i * 8]), h[i]));
+  }
+
+#endif
+
+// number of messages hashed at once on this CPU; 1 without AVX2
+size_t simd_lanes() {
+#ifdef SHA512_X86
+  static const size_t lanes = __builtin_cpu_supports("avx512f") ? 8 : __builtin_cpu_supports("avx2") ? 4 : 1;
+  return lanes;
+#else
+  return 1;
+#endif
+  }
+
+// hashes messages first to last - 1 on 4 or 8 lanes, reading each a block at
+// a time from source:
+//
+// source.start(lane, i) begins message i on a lane
+// source.read(lane, block) writes up to BLOCK_SIZE bytes of the message on a
+//   lane and returns how many; the message ends with its first short read
+// source.done(lane, i, h, len) is given the digest words and length of
+//   message i
+template<typename source_t>
+void hash_lanes(size_t first, size_t last, size_t lanes, source_t &source) {
+  struct lane_t {
+    size_t message = 0;
+    std::uint32_t len = 0;
+    size_t block_nb = 0;
+    size_t block = 0;
+    bool active = false;
+    bool ended = false;
+    byte blocks[2 * BLOCK_SIZE];
+    };
+  static const byte empty[BLOCK_SIZE] = {};
+  std::array<lane_t, MAX_LANES> lane_state;
+  std::array<std::uint64_t, 8 * MAX_LANES> state;
+  std::array<const byte*, MAX_LANES> blocks;
+  size_t next = first, active = 0;
+
+  auto start = [&](size_t l) {
+    auto &lane = lane_state[l];
+    lane.active = next < last;
+    if (not lane.active)
+      return;
+    lane.message = next++;
+    lane.len = 0;
+    lane.block_nb = lane.block = 0;
+    lane.ended = false;
+    for (size_t i = 0; i < 8; i++)
+      state[i * lanes + l] = H0[i];
+    source.start(l, lane.message);
+    active++;
+    };
+
+  for (size_t l = 0; l < lanes; l++)
+    start(l);
+
+  while (active) {
+    for (size_t l = 0; l < lanes; l++) {
+      auto &lane = lane_state[l];
+      if (not lane.active) {
+        blocks[l] = empty;
+        continue;
+        }
+      if (lane.block == lane.block_nb) {
+        size_t len = source.read(l, lane.blocks);
+        lane.len += len;
+        lane.block = 0;
+        lane.block_nb = 1;
+        if (len < BLOCK_SIZE) {
+          lane.ended = true;
+          lane.block_nb = pad(lane.blocks, len, lane.len);
+          }
+        }
+      blocks[l] = lane.blocks + (lane.block++ << 7);
+      }
+#ifdef SHA512_X86
+    if (lanes == 8)
+      transform_avx512(state.data(), blocks.data());
+    else
+      transform_avx2(state.data(), blocks.data());
+#endif
+    for (size_t l = 0; l < lanes; l++) {
+      auto &lane = lane_state[l];
+      if (lane.active and lane.ended and lane.block == lane.block_nb) {
+        std::uint64_t h[8];
+        for (size_t i = 0; i < 8; i++)
+          h[i] = state[i * lanes + l];
+        source.done(l, lane.message, h, lane.len);
+        active--;
+        start(l);
+        }
+      }
+    }
+  }
+
+// lane count used by hash() for a requested count: 8, 4 or 1, with 0 asking
+// for the widest available
+size_t lane_count(size_t lanes) {
+  if (lanes == 0 or lanes > simd_lanes())
+    lanes = simd_lanes();
+  return lanes >= 8 ? 8 : lanes >= 4 ? 4 : 1;
+  }
+
+// messages per call to hash_lanes when a batch is split between threads
+static const size_t LANE_BATCH = 256;
+
+struct string_source {
+  const std::vector<std::string> &inputs;
+  std::vector<std::string> &digests;
+  std::array<size_t, MAX_LANES> messages = {};
+  std::array<size_t, MAX_LANES> offsets = {};
+  void start(size_t lane, size_t i) {
+    this->messages[lane] = i;
+    this->offsets[lane] = 0;
+    }
+  size_t read(size_t lane, byte *block) {
+    const auto &input = this->inputs[this->messages[lane]];
+    size_t len = std::min((size_t) BLOCK_SIZE, input.size() - this->offsets[lane]);
+    std::memcpy(block, input.data() + this->offsets[lane], len);
+    this->offsets[lane] += len;
+    return len;
+    }
+  void done(size_t, size_t i, const std::uint64_t *h, std::uint32_t) {
+    this->digests[i] = digest_str(h);
+    }
+  };
+
+// hashes every input, several at a time where the CPU allows; lanes as for
+// lane_count(), with 1 hashing each input on its own
+std::vector<std::string> hash(const std::vector<std::string> &inputs, size_t lanes=0) {
+  std::vector<std::string> digests(inputs.size());
+  lanes = lane_count(lanes);
+
+  if (lanes == 1) {
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < inputs.size(); i++)
+      digests[i] = hash(inputs[i]);
+    return digests;
+    }
+
+  #pragma omp parallel for schedule(dynamic)
+  for (size_t first = 0; first < inputs.size(); first += LANE_BATCH) {
+    string_source source{inputs, digests};
+    hash_lanes(first, std::min(first + LANE_BATCH, inputs.size()), lanes, source);
+    }
+  return digests;
+  }
+
 } // namespace sha512
@@ -0,0 +1,39 @@
+// sha512.hpp
+
+#pragma once
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+#include <fmt/compile.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace sha512 {
+
+typedef unsigned char byte;
+
+// incremental sha-512 of one message; str() gives the hex digest once
+// finish() has been called
+class sha512 {
+  public:
+  std::array<std::uint64_t, 8> h = {
+    0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+    0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+    };
+  void update(const byte* message, std::uint32_t len);
+  void finish();
+  std::string str();
+  private:
+  // room for the two blocks finish() may pad the message into
+  byte block[2 * 128] = {};
+  std::uint32_t len = 0;
+  std::uint32_t tot_len = 0;
+  void transform(const byte* message, std::uint32_t block_nb);
+  };
+
+std::string hash(const std::string &input);
+
+} // namespace sha512
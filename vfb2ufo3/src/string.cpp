@@ -13,6 +13,58 @@ static std::string number_str(double n) {
   return float_str(n);
   }
 
+static inline void append(auto &buf, std::string_view str) {
+  buf.append(str.data(), str.data() + str.size());
+  }
+
+// integer and single-decimal values below this magnitude are written
+// directly, anything else falls back to fmt
+#define NUMBER_FAST_LIMIT (1e9)
+
+// writes n as digits, the last decimals of them after a decimal point
+static inline void digits_str(auto &buf, std::uint64_t n, int decimals=0) {
+  char digits[24];
+  char *end = digits + sizeof(digits);
+  char *p = end;
+  for (int i = 0; i < decimals; i++) {
+    *--p = '0' + n % 10;
+    n /= 10;
+    }
+  if (decimals)
+    *--p = '.';
+  do {
+    *--p = '0' + n % 10;
+    n /= 10;
+    } while (n);
+  buf.append(p, end);
+  }
+
+static inline void float_str(auto &buf, float n, int precision=1) {
+  float magnitude = std::fabs(n);
+  if (precision != 1 or not (magnitude < NUMBER_FAST_LIMIT)) {
+    fmt::format_to(std::back_inserter(buf), FMT_COMPILE("{:.{}f}"), n, precision);
+    return;
+    }
+  // a float scaled by 10 is exact as a double, and nearbyint rounds ties to
+  // even the same way fmt does
+  if (std::signbit(n))
+    buf.push_back('-');
+  digits_str(buf, (std::uint64_t) std::nearbyint(magnitude * 10.0), 1);
+  }
+
+static void number_str(auto &buf, double n) {
+  double k = std::nearbyint(n);
+  if (not (std::fabs(n - k) < 0.05))
+    float_str(buf, n);
+  else if (std::fabs(k) < NUMBER_FAST_LIMIT) {
+    if (k < 0)
+      buf.push_back('-');
+    digits_str(buf, (std::uint64_t) std::fabs(k));
+    }
+  else
+    fmt::format_to(std::back_inserter(buf), FMT_COMPILE("{}"), (int) k);
+  }
+
 static inline std::string attr(const std::string &name, const std::string &value) {
   return fmt::format(FMT_COMPILE("{}=\"{}\" "), name, value);
   }
@@ -0,0 +1,177 @@
+// uring.cpp
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// io_uring on the raw system calls, so nothing beyond the kernel headers is
+// needed to build it
+//
+// one thread queues requests with get_sqe() and hands them to the kernel
+// with submit(), which waits for every one of them to complete; at most
+// depth() requests may be queued between submits
+class io_ring {
+  public:
+  io_ring() {}
+  ~io_ring();
+  io_ring(const io_ring&) = delete;
+  io_ring &operator=(const io_ring&) = delete;
+  bool open(unsigned entries, const std::vector<int> &ops);
+  void close();
+  unsigned depth() const;
+  io_uring_sqe *get_sqe();
+  int submit(auto complete);
+  private:
+  int fd = -1;
+  io_uring_params params = {};
+  void *sq_ring = MAP_FAILED;
+  void *cq_ring = MAP_FAILED;
+  void *sqes_map = MAP_FAILED;
+  size_t sq_ring_size = 0;
+  size_t cq_ring_size = 0;
+  size_t sqes_size = 0;
+  unsigned *sq_tail = nullptr;
+  unsigned *sq_mask = nullptr;
+  unsigned *sq_array = nullptr;
+  unsigned *cq_head = nullptr;
+  unsigned *cq_tail = nullptr;
+  unsigned *cq_mask = nullptr;
+  io_uring_sqe *sqes = nullptr;
+  io_uring_cqe *cqes = nullptr;
+  unsigned tail = 0;
+  unsigned submitted = 0;
+  bool supports(const std::vector<int> &ops) const;
+  };
+
+// the ring indexes are shared with the kernel, which reads what is released
+// and releases what it writes
+static inline unsigned load_acquire(unsigned *index) {
+  return std::atomic_ref<unsigned>(*index).load(std::memory_order_acquire);
+  }
+
+static inline void store_release(unsigned *index, unsigned value) {
+  std::atomic_ref<unsigned>(*index).store(value, std::memory_order_release);
+  }
+
+io_ring::~io_ring() {
+  this->close();
+  }
+
+// sets up a ring of at least entries requests; false where the kernel has no
+// io_uring or does not support every op in ops
+bool io_ring::open(unsigned entries, const std::vector<int> &ops) {
+  this->fd = (int) ::syscall(__NR_io_uring_setup, entries, &this->params);
+  if (this->fd < 0)
+    return false;
+  if (not this->supports(ops)) {
+    this->close();
+    return false;
+    }
+
+  const auto &params = this->params;
+  this->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  this->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_map)
+    this->sq_ring_size = this->cq_ring_size = std::max(this->sq_ring_size, this->cq_ring_size);
+
+  this->sq_ring = ::mmap(nullptr, this->sq_ring_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQ_RING);
+  if (this->sq_ring != MAP_FAILED)
+    this->cq_ring = single_map ? this->sq_ring : ::mmap(nullptr, this->cq_ring_size,
+      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_CQ_RING);
+  this->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  if (this->cq_ring != MAP_FAILED)
+    this->sqes_map = ::mmap(nullptr, this->sqes_size, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQES);
+  if (this->sqes_map == MAP_FAILED) {
+    this->close();
+    return false;
+    }
+
+  char *sq = (char*) this->sq_ring;
+  char *cq = (char*) this->cq_ring;
+  this->sq_tail = (unsigned*) (sq + params.sq_off.tail);
+  this->sq_mask = (unsigned*) (sq + params.sq_off.ring_mask);
+  this->sq_array = (unsigned*) (sq + params.sq_off.array);
+  this->cq_head = (unsigned*) (cq + params.cq_off.head);
+  this->cq_tail = (unsigned*) (cq + params.cq_off.tail);
+  this->cq_mask = (unsigned*) (cq + params.cq_off.ring_mask);
+  this->sqes = (io_uring_sqe*) this->sqes_map;
+  this->cqes = (io_uring_cqe*) (cq + params.cq_off.cqes);
+  this->tail = this->submitted = *this->sq_tail;
+  return true;
+  }
+
+bool io_ring::supports(const std::vector<int> &ops) const {
+  std::vector<char> buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+  auto *probe = (io_uring_probe*) buffer.data();
+  if (::syscall(__NR_io_uring_register, this->fd, IORING_REGISTER_PROBE, probe, 256) < 0)
+    return false;
+  for (int op : ops)
+    if (op > probe->last_op or not (probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+      return false;
+  return true;
+  }
+
+void io_ring::close() {
+  if (this->sqes_map != MAP_FAILED)
+    ::munmap(this->sqes_map, this->sqes_size);
+  if (this->cq_ring != MAP_FAILED and this->cq_ring != this->sq_ring)
+    ::munmap(this->cq_ring, this->cq_ring_size);
+  if (this->sq_ring != MAP_FAILED)
+    ::munmap(this->sq_ring, this->sq_ring_size);
+  if (this->fd >= 0)
+    ::close(this->fd);
+  this->sqes_map = this->cq_ring = this->sq_ring = MAP_FAILED;
+  this->fd = -1;
+  }
+
+unsigned io_ring::depth() const {
+  return this->params.sq_entries;
+  }
+
+// the next free request, cleared
+io_uring_sqe *io_ring::get_sqe() {
+  unsigned index = this->tail++ & *this->sq_mask;
+  io_uring_sqe *sqe = &this->sqes[index];
+  std::memset(sqe, 0, sizeof(io_uring_sqe));
+  this->sq_array[index] = index;
+  return sqe;
+  }
+
+// submits the queued requests and hands the user data and result of each
+// completion to complete; returns 0, or the errno of a failed submission,
+// after which the ring should not be used again
+int io_ring::submit(auto complete) {
+  unsigned queued = this->tail - this->submitted;
+  store_release(this->sq_tail, this->tail);
+  for (unsigned completed = 0; completed < queued;) {
+    int result = (int) ::syscall(__NR_io_uring_enter, this->fd,
+      this->tail - this->submitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno;
+      }
+    this->submitted += result;
+
+    unsigned head = *this->cq_head;
+    for (unsigned end = load_acquire(this->cq_tail); head != end; head++, completed++) {
+      const io_uring_cqe &cqe = this->cqes[head & *this->cq_mask];
+      complete(cqe.user_data, cqe.res);
+      }
+    store_release(this->cq_head, head);
+    }
+  return 0;
+  }
@@ -0,0 +1,142 @@
+// tests/archive.cpp
+
+// writes an archive of mock glifs with zip_file, then updates it in place
+// with one glif changed, one removed and one added; checks that unchanged
+// entries are copied raw with their payloads intact, including an entry
+// stored because it did not shrink, that every entry of the updated archive
+// inflates to its new contents, that an update which cannot be written
+// leaves the previous archive in place, and that turning compression off and
+// on again writes every entry again
+//
+// g++ -std=c++20 -O2 -fopenmp tests/archive.cpp -lz -o archive
+
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/archive.cpp"
+
+const size_t GLIFS = 3000;
+
+std::map<std::string, std::string> mock_glifs() {
+  std::map<std::string, std::string> glifs;
+  for (size_t i = 0; i < GLIFS; i++) {
+    std::string name = "glyph" + std::to_string(i);
+    std::string data = "<glyph name=\"" + name + "\" format=\"2\">\n";
+    for (size_t j = 0; j < i % 40 + 1; j++)
+      data += "\t<point x=\"" + std::to_string(i * j % 997) + "\" y=\"" + std::to_string(j * 31) + "\"/>\n";
+    glifs["glyphs/" + name + ".glif"] = data + "</glyph>\n";
+    }
+  // random bytes do not shrink when deflated, so this entry is stored
+  std::mt19937 rng(1);
+  std::string random(4096, '\0');
+  for (auto &c : random)
+    c = rng();
+  glifs["data/random.bin"] = random;
+  return glifs;
+  }
+
+// returns the number of entries copied, or -1 if the archive was not written
+size_t write(const std::string &path, const std::map<std::string, std::string> &glifs, bool compress) {
+  zip::zip_file archive(path, compress, 0, "best", true);
+  archive.reserve(glifs.size());
+  for (const auto &[arc_name, data] : glifs)
+    archive.add_entry(arc_name, data);
+  return archive.close().empty() ? archive.copied : (size_t) -1;
+  }
+
+std::string inflate_str(const std::string &payload, size_t size) {
+  std::string data(size, '\0');
+  z_stream stream = {};
+  inflateInit2(&stream, -15);
+  stream.next_in = (u_char*)payload.data();
+  stream.avail_in = payload.size();
+  stream.next_out = (u_char*)data.data();
+  stream.avail_out = data.size();
+  int status = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  return status == Z_STREAM_END ? data : std::string();
+  }
+
+// payloads of every entry of an archive, with their contents
+struct archive_entries {
+  std::map<std::string, std::string> payloads;
+  std::map<std::string, std::string> contents;
+  };
+
+bool read_archive(const std::string &path, archive_entries &entries) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<zip::zip_info> zinfo_list;
+  if (not zip::read_central_directory(file, zinfo_list))
+    return false;
+  for (const auto &zinfo : zinfo_list) {
+    std::uint64_t offset;
+    if (not zip::read_payload_offset(file, zinfo, offset))
+      return false;
+    std::string payload(zinfo.compressed_size, '\0');
+    file.seekg(offset);
+    file.read(payload.data(), payload.size());
+    std::string data = zinfo.compression_method == ZIP_STORED ? payload : inflate_str(payload, zinfo.uncompressed_size);
+    if (crc32_z(0, (const u_char*)data.data(), data.size()) != zinfo.crc)
+      return false;
+    entries.payloads[zinfo.arc_name] = payload;
+    entries.contents[zinfo.arc_name] = data;
+    }
+  return true;
+  }
+
+int main() {
+  std::string path = "/tmp/vfb2ufo3_archive_test.ufoz";
+  auto glifs = mock_glifs();
+
+  std::cout << "a new archive copies no entries\n";
+  std::cout << (write(path, glifs, true) == 0 ? "pass\n" : "fail\n");
+  archive_entries before;
+  bool pass = read_archive(path, before) and before.contents == glifs;
+
+  glifs["glyphs/glyph7.glif"] += "<!-- changed -->\n";
+  glifs.erase("glyphs/glyph9.glif");
+  glifs["glyphs/added.glif"] = "<glyph name=\"added\" format=\"2\">\n</glyph>\n";
+  size_t copied = write(path, glifs, true);
+
+  std::cout << "an update copies only unchanged entries, stored ones included\n";
+  std::cout << (pass and copied == GLIFS - 1 and before.payloads["data/random.bin"] == glifs["data/random.bin"] ? "pass\n" : "fail\n");
+
+  archive_entries after;
+  pass = read_archive(path, after) and after.contents == glifs;
+  for (const auto &[arc_name, payload] : after.payloads)
+    if (arc_name != "glyphs/glyph7.glif" and arc_name != "glyphs/added.glif")
+      pass = pass and payload == before.payloads[arc_name];
+  std::cout << "updated archive has the new contents and the copied payloads\n";
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  // the temporary archive cannot be created where a directory is in its way
+  std::filesystem::create_directory(path + ".tmp");
+  glifs["glyphs/glyph8.glif"] += "<!-- changed -->\n";
+  std::cout << "an update that cannot be written keeps the previous archive\n";
+  pass = write(path, glifs, true) == (size_t) -1;
+  archive_entries kept;
+  pass = pass and read_archive(path, kept) and kept.payloads == after.payloads;
+  std::cout << (pass ? "pass\n" : "fail\n");
+  std::filesystem::remove(path + ".tmp");
+
+  // only the entry that was stored already is copied
+  std::cout << "turning compression off stores every entry again\n";
+  pass = write(path, glifs, false) == 1;
+  archive_entries stored;
+  pass = pass and read_archive(path, stored) and stored.contents == glifs and stored.payloads == glifs;
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  std::cout << "turning compression on again compresses every entry again\n";
+  pass = write(path, glifs, true) == 0;
+  archive_entries compressed;
+  pass = pass and read_archive(path, compressed) and compressed.contents == glifs and
+    compressed.payloads["glyphs/glyph0.glif"] != glifs["glyphs/glyph0.glif"];
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  std::remove(path.c_str());
+  }
@@ -0,0 +1,272 @@
+// tests/benchmark.cpp
+
+// benchmarks the glif and archive stages of the C++ core on a synthetic font
+// and prints ns/glyph, MB/s and allocations for each stage as JSON
+//
+// g++ -std=c++20 -O2 -fopenmp tests/benchmark.cpp -lz -o benchmark
+// ./benchmark [glyphs=3000] [points=60] [components=0.3] [replacements=0.2]
+//   [offcurve=0.5] [curve=0.2] [qcurve=0.05] [seed=1] [archive=benchmark.ufoz]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "synthetic.cpp"
+
+static std::atomic<size_t> allocations(0);
+
+// every form of operator new is counted and every form of operator delete
+// frees with std::free, so arrays, sized and aligned allocations are all
+// counted and each new is paired with a matching delete
+static inline void *counted_alloc(size_t size, size_t align) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  size = size ? size : 1;
+  if (align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+    return std::malloc(size);
+  return std::aligned_alloc(align, (size + align - 1) / align * align);
+  }
+
+static inline void *counted_new(size_t size, size_t align) {
+  if (void *p = counted_alloc(size, align))
+    return p;
+  throw std::bad_alloc();
+  }
+
+void *operator new(size_t size) {
+  return counted_new(size, 0);
+  }
+void *operator new[](size_t size) {
+  return counted_new(size, 0);
+  }
+void *operator new(size_t size, std::align_val_t align) {
+  return counted_new(size, (size_t) align);
+  }
+void *operator new[](size_t size, std::align_val_t align) {
+  return counted_new(size, (size_t) align);
+  }
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+  return counted_alloc(size, 0);
+  }
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return counted_alloc(size, 0);
+  }
+void *operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+  return counted_alloc(size, (size_t) align);
+  }
+void *operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+  return counted_alloc(size, (size_t) align);
+  }
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+  }
+void operator delete[](void *p) noexcept {
+  std::free(p);
+  }
+void operator delete(void *p, size_t) noexcept {
+  std::free(p);
+  }
+void operator delete[](void *p, size_t) noexcept {
+  std::free(p);
+  }
+void operator delete(void *p, std::align_val_t) noexcept {
+  std::free(p);
+  }
+void operator delete[](void *p, std::align_val_t) noexcept {
+  std::free(p);
+  }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+  }
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+  }
+void operator delete(void *p, const std::nothrow_t&) noexcept {
+  std::free(p);
+  }
+void operator delete[](void *p, const std::nothrow_t&) noexcept {
+  std::free(p);
+  }
+void operator delete(void *p, std::align_val_t, const std::nothrow_t&) noexcept {
+  std::free(p);
+  }
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t&) noexcept {
+  std::free(p);
+  }
+
+struct stage_result {
+  std::string name;
+  double seconds;
+  size_t glyphs;
+  size_t bytes;
+  size_t allocations;
+  };
+
+// runs stage, which returns the number of bytes it produced or consumed
+stage_result run_stage(const std::string &name, size_t glyphs, auto stage) {
+  size_t start_allocations = allocations.load();
+  auto start = std::chrono::steady_clock::now();
+  size_t bytes = stage();
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+  return {name, seconds.count(), glyphs, bytes, allocations.load() - start_allocations};
+  }
+
+std::string stage_json(const stage_result &result) {
+  return fmt::format(
+    "    {{\"stage\": \"{}\", \"seconds\": {:.6f}, \"ns_per_glyph\": {:.1f}, "
+    "\"mb_per_s\": {:.2f}, \"bytes\": {}, \"allocations\": {}, \"allocations_per_glyph\": {:.2f}}}",
+    result.name,
+    result.seconds,
+    result.seconds * 1e9 / result.glyphs,
+    result.bytes / result.seconds / 1e6,
+    result.bytes,
+    result.allocations,
+    (double) result.allocations / result.glyphs);
+  }
+
+void parse_arg(synthetic_options &options, std::string &archive_path, const std::string &arg) {
+  size_t split = arg.find('=');
+  std::string key = arg.substr(0, split);
+  std::string value = split == std::string::npos ? "" : arg.substr(split + 1);
+  if (key == "glyphs")
+    options.glyphs = std::stoul(value);
+  else if (key == "points")
+    options.points = std::stoul(value);
+  else if (key == "components")
+    options.components = std::stod(value);
+  else if (key == "replacements")
+    options.replacements = std::stod(value);
+  else if (key == "offcurve")
+    options.offcurve = std::stod(value);
+  else if (key == "curve")
+    options.curve = std::stod(value);
+  else if (key == "qcurve")
+    options.qcurve = std::stod(value);
+  else if (key == "seed")
+    options.seed = std::stoul(value);
+  else if (key == "archive")
+    archive_path = value;
+  else
+    std::cerr << "unknown option " << arg << '\n';
+  }
+
+int main(int argc, char *argv[]) {
+  synthetic_options options;
+  std::string archive_path = "benchmark.ufoz";
+  for (int i = 1; i < argc; i++)
+    parse_arg(options, archive_path, argv[i]);
+
+  cpp_ufo ufo;
+  synthetic_font(ufo, options);
+  size_t n = ufo.glifs.size();
+  std::vector<stage_result> results;
+  std::vector<std::string> glifs(n);
+
+  results.push_back(run_stage("glif_repr", n, [&]() {
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+      glifs[i] = ufo.glifs[i].repr(ufo);
+      bytes += glifs[i].size();
+      }
+    return bytes;
+    }));
+
+  arena_pool arenas;
+  results.push_back(run_stage("arena_repr", n, [&]() {
+    size_t bytes = 0;
+    for (const auto &glif : ufo.glifs)
+      bytes += arena_repr(glif, ufo, arenas).size();
+    arenas.release();
+    return bytes;
+    }));
+
+  for (int hint_type : {1, 2, 3}) {
+    ufo.hint_type = hint_type;
+    results.push_back(run_stage(fmt::format("hints_repr_{}", hint_type), n, [&]() {
+      fmt::memory_buffer buf;
+      size_t bytes = 0;
+      for (const auto &glif : ufo.glifs)
+        if (glif.vhints.size() or glif.hhints.size()) {
+          buf.clear();
+          hints_repr(buf, glif, ufo);
+          bytes += buf.size();
+          }
+      return bytes;
+      }));
+    }
+  results.push_back(run_stage("build_hint_ids", n, [&]() {
+    build_hint_ids(ufo);
+    size_t bytes = 0;
+    for (const auto &id : ufo.hint_ids)
+      bytes += id.second.size();
+    return bytes;
+    }));
+  ufo.hint_ids.clear();
+  ufo.hint_type = options.hint_type;
+
+  ufo.optimize = true;
+  results.push_back(run_stage("build_components", n, [&]() {
+    build_components(ufo);
+    size_t bytes = 0;
+    for (const auto &contours : ufo.completed_contours)
+      bytes += contours.second.size();
+    return bytes;
+    }));
+  results.push_back(run_stage("add_contours", n, [&]() {
+    fmt::memory_buffer buf;
+    size_t bytes = 0;
+    for (const auto &glif : ufo.glifs) {
+      buf.clear();
+      for (const auto &component : glif.components)
+        add_contours(buf, ufo, component);
+      bytes += buf.size();
+      }
+    return bytes;
+    }));
+  ufo.optimize = options.optimize;
+
+  results.push_back(run_stage("deflate_str", n, [&]() {
+    size_t bytes = 0;
+    for (const auto &glif : glifs) {
+      zip::deflate_str(glif);
+      bytes += glif.size();
+      }
+    return bytes;
+    }));
+
+  std::unordered_map<std::string, std::string> files;
+  for (size_t i = 0; i < n; i++)
+    files[ufo.glifs[i].path] = glifs[i];
+  results.push_back(run_stage("write_archive", n, [&]() {
+    zip::write_archive(archive_path, files, true);
+    std::ifstream archive(archive_path, std::ios::binary | std::ios::ate);
+    return (size_t) archive.tellg();
+    }));
+  std::remove(archive_path.c_str());
+
+  results.push_back(run_stage("archive_glifs", n, [&]() {
+    zip::zip_file archive(archive_path, true);
+    archive.reserve(n);
+    archive_glifs(ufo, archive);
+    archive.close();
+    std::ifstream written(archive_path, std::ios::binary | std::ios::ate);
+    return (size_t) written.tellg();
+    }));
+  std::remove(archive_path.c_str());
+
+  std::cout << "{\n"
+    << fmt::format("  \"glyphs\": {}, \"points\": {}, \"components\": {}, \"replacements\": {},\n",
+      options.glyphs, options.points, options.components, options.replacements)
+    << fmt::format("  \"offcurve\": {}, \"curve\": {}, \"qcurve\": {}, \"seed\": {}, \"threads\": {},\n",
+      options.offcurve, options.curve, options.qcurve, options.seed, omp_get_max_threads())
+    << "  \"stages\": [\n";
+  for (size_t i = 0; i < results.size(); i++)
+    std::cout << stage_json(results[i]) << (i + 1 < results.size() ? ",\n" : "\n");
+  std::cout << "    ]\n}\n";
+  }
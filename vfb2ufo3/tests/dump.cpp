@@ -0,0 +1,266 @@
+// tests/dump.cpp
+
+// writes a synthetic font to a glyph dump and checks that instances built
+// from it by the headless converter match the glifs of the original, that
+// masters are blended by their axis bits, that cpp_instances builds the same
+// instances and kerning from the dump in memory, and that damaged dumps are
+// refused
+//
+// g++ -std=c++20 -O2 -fopenmp tests/dump.cpp -lz -o dump
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "synthetic.cpp"
+#include "../src/instance.cpp"
+
+const char *DUMP_PATH = "test.vfbd";
+const size_t AXES = 2;
+const float MASTER_DELTA = 10.0f;
+
+// per-master values of a coordinate, moved by MASTER_DELTA for each master
+std::vector<float> master_values(float value, bool delta=true) {
+  std::vector<float> values;
+  for (size_t m = 0; m < (1u << AXES); m++)
+    values.push_back(value + (delta ? m * MASTER_DELTA : 0.0f));
+  return values;
+  }
+
+// rounds every coordinate to the integer grid of a FontLab instance
+void round_font(cpp_ufo &ufo) {
+  for (auto &x : ufo.outlines.x)
+    x = std::nearbyint(x);
+  for (auto &y : ufo.outlines.y)
+    y = std::nearbyint(y);
+  for (auto &glif : ufo.glifs) {
+    glif.width = std::nearbyint(glif.width);
+    for (auto &anchor : glif.anchors) {
+      anchor.x = std::nearbyint(anchor.x);
+      anchor.y = std::nearbyint(anchor.y);
+      }
+    for (auto &component : glif.components) {
+      component.offset.x = std::nearbyint(component.offset.x);
+      component.offset.y = std::nearbyint(component.offset.y);
+      }
+    for (auto *hints : {&glif.vhints, &glif.hhints})
+      for (auto &hint : *hints) {
+        hint.width = std::nearbyint(hint.width);
+        hint.position = std::nearbyint(hint.position);
+        }
+    }
+  }
+
+// moves every coordinate by offset, as blending the masters of the dump does
+void offset_font(cpp_ufo &ufo, float offset) {
+  for (auto &x : ufo.outlines.x)
+    x += offset;
+  for (auto &y : ufo.outlines.y)
+    y += offset;
+  for (auto &glif : ufo.glifs) {
+    glif.width += offset;
+    for (auto &anchor : glif.anchors) {
+      anchor.x += offset;
+      anchor.y += offset;
+      }
+    for (auto &component : glif.components) {
+      component.offset.x += offset;
+      component.offset.y += offset;
+      }
+    for (auto *hints : {&glif.vhints, &glif.hhints})
+      for (auto &hint : *hints) {
+        hint.width += offset;
+        hint.position += offset;
+        }
+    }
+  }
+
+// a kerning pair from each glif to the next, with the glif index as its value
+void dump_kerning(const cpp_ufo &ufo, dump_writer &writer) {
+  for (size_t i = 1; i < ufo.glifs.size(); i++)
+    writer.add_kern_pair(ufo.glifs[i - 1].index, ufo.glifs[i].index, master_values(-(float) i));
+  }
+
+// hints are stored in the argument order glif_hints() passes to cpp_hint
+void dump_font(const cpp_ufo &ufo, dump_writer &writer) {
+  for (const auto &glif : ufo.glifs) {
+    std::vector<long> code_points(glif.code_points.begin(), glif.code_points.end());
+    writer.add_glyph(
+      glif.index,
+      glif.name,
+      std::filesystem::path(glif.path).filename().string(),
+      glif.mark,
+      code_points,
+      glif.omit,
+      glif.base,
+      glif.vhints.size() or glif.hhints.size(),
+      master_values(glif.width));
+    for (size_t c = glif.outline.start; c < glif.outline.end; c++) {
+      writer.add_contour();
+      for (size_t i = ufo.outlines.start(c); i < ufo.outlines.end(c); i++) {
+        auto hintset = ufo.outlines.hintsets.find(i);
+        writer.add_point(
+          master_values(ufo.outlines.x[i]),
+          master_values(ufo.outlines.y[i]),
+          ufo.outlines.types[i] & POINT_TYPE_MASK,
+          ufo.outlines.types[i] & POINT_SMOOTH ? 1 : 0,
+          hintset == ufo.outlines.hintsets.end() ? DUMP_NO_HINTSET : hintset->second);
+        }
+      }
+    for (const auto &component : glif.components)
+      writer.add_component(
+        component.base,
+        component.index,
+        master_values(component.offset.x),
+        master_values(component.offset.y),
+        master_values(component.scale.x, false),
+        master_values(component.scale.y, false));
+    for (const auto &anchor : glif.anchors)
+      writer.add_anchor(anchor.name, master_values(anchor.x), master_values(anchor.y));
+    for (const auto &hint : glif.vhints)
+      writer.add_hint(master_values(hint.width), master_values(hint.position), true, hint.ghost);
+    for (const auto &hint : glif.hhints)
+      writer.add_hint(master_values(hint.width), master_values(hint.position), false, hint.ghost);
+    for (const auto &replacement : glif.hint_replacements)
+      writer.add_replacement(replacement.type, replacement.index);
+    }
+  dump_kerning(ufo, writer);
+  }
+
+bool same_glifs(cpp_ufo &expected, cpp_ufo &built) {
+  if (expected.glifs.size() != built.glifs.size())
+    return false;
+  for (size_t i = 0; i < expected.glifs.size(); i++)
+    if (expected.glifs[i].repr(expected) != built.glifs[i].repr(built))
+      return false;
+  return true;
+  }
+
+bool check_instance(cpp_ufo &original, const std::vector<double> &values, float offset) {
+  dump_reader dump;
+  if (not dump.open(DUMP_PATH).empty())
+    return false;
+
+  cpp_ufo expected = original;
+  offset_font(expected, offset);
+
+  cpp_ufo built;
+  built.hint_type = original.hint_type;
+  built.optimize = original.optimize;
+  built.ufoz = original.ufoz;
+  build_ufo(dump, master_weights(values, AXES), built, "synthetic.ufo/glyphs", 0.0f);
+  return same_glifs(expected, built);
+  }
+
+// builds every instance at once from the dump in memory and checks each
+// against build_ufo, the expected kerning values and the anchors of the
+// unscaled instance
+bool check_instances(cpp_ufo &original, const dump_writer &writer, const std::vector<std::vector<double>> &values, float scale) {
+  cpp_instances instances;
+  if (not instances.load(writer.data()).empty())
+    return false;
+  std::vector<std::string> glyphs_paths(values.size(), "synthetic.ufo/glyphs");
+  cpp_marks marks;
+  marks.set_anchors({"top"}, {"top"});
+  instances.build(values, glyphs_paths, original.hint_type, original.ufoz, scale, '/', marks);
+
+  for (size_t i = 0; i < values.size(); i++) {
+    auto weights = master_weights(values[i], AXES);
+    cpp_ufo expected;
+    expected.hint_type = original.hint_type;
+    expected.optimize = false;
+    expected.ufoz = original.ufoz;
+    build_ufo(instances.dump, weights, expected, "synthetic.ufo/glyphs", scale);
+    if (not same_glifs(expected, instances.ufos[i]))
+      return false;
+
+    cpp_ufo unscaled;
+    cpp_marks expected_marks = marks;
+    build_ufo(instances.dump, weights, unscaled, "synthetic.ufo/glyphs", 0.0f);
+    expected_marks.scan(unscaled.glifs);
+    std::string feature = instances.marks[i].feature(scale ? scale : 1.0);
+    if (feature.empty() or feature != expected_marks.feature(scale ? scale : 1.0))
+      return false;
+
+    double offset = 0.0;
+    for (size_t m = 0; m < weights.size(); m++)
+      offset += weights[m] * m * MASTER_DELTA;
+    const auto &kerning = instances.kerning[i];
+    if (kerning.size() != original.glifs.size() - 1)
+      return false;
+    for (size_t j = 0; j < kerning.size(); j++) {
+      long value = std::nearbyint(offset - (double) (j + 1));
+      if (scale)
+        value = value * scale;
+      if (kerning[j].first != original.glifs[j].index or
+          kerning[j].second != original.glifs[j + 1].index or
+          kerning[j].value != value)
+        return false;
+      }
+    instances.release(i);
+    if (instances.ufos[i].glifs.size() or instances.kerning[i].size())
+      return false;
+    }
+  return true;
+  }
+
+// rewrites the dump with one byte changed or the file cut short, and checks
+// that it is refused on opening
+bool check_refused(const std::string &data, size_t offset, size_t size) {
+  std::string damaged = data.substr(0, size);
+  if (offset < damaged.size())
+    damaged[offset] ^= 0x7f;
+  std::ofstream(DUMP_PATH, std::ios::binary) << damaged;
+  dump_reader dump;
+  return not dump.open(DUMP_PATH).empty();
+  }
+
+int main() {
+  synthetic_options options;
+  options.glyphs = 500;
+  cpp_ufo ufo;
+  synthetic_font(ufo, options);
+  round_font(ufo);
+
+  dump_writer writer(AXES, 1000, "Synthetic");
+  dump_font(ufo, writer);
+  if (writer.write(DUMP_PATH) != 0) {
+    std::cout << "fail: could not write " << DUMP_PATH << '\n';
+    return 1;
+    }
+
+  // the offsets are exact: master m moves by m * MASTER_DELTA, and the
+  // instance weights average m to t0 + 2 * t1
+  std::cout << "master 0 matches the original glifs\n";
+  std::cout << (check_instance(ufo, {0, 0}, 0) ? "pass\n" : "fail\n");
+  std::cout << "master 3 is moved by 3 steps\n";
+  std::cout << (check_instance(ufo, {1000, 1000}, 3 * MASTER_DELTA) ? "pass\n" : "fail\n");
+  std::cout << "instance 500,250 is moved by 1 step\n";
+  std::cout << (check_instance(ufo, {500, 250}, MASTER_DELTA) ? "pass\n" : "fail\n");
+
+  std::cout << "instances built together match build_ufo, kerning and anchors\n";
+  std::vector<std::vector<double>> values = {{0, 0}, {1000, 1000}, {500, 250}, {250, 750}, {1000, 0}, {330, 670}};
+  std::cout << (check_instances(ufo, writer, values, 0.0f) ? "pass\n" : "fail\n");
+  std::cout << "scaled instances built together match build_ufo, kerning and anchors\n";
+  std::cout << (check_instances(ufo, writer, values, 0.5f) ? "pass\n" : "fail\n");
+
+  std::ifstream file(DUMP_PATH, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  file.close();
+
+  std::cout << "damaged dumps are refused\n";
+  bool pass =
+    check_refused(data, 0, data.size()) and
+    check_refused(data, 4, data.size()) and
+    check_refused(data, data.size(), sizeof(dump_header) - 1) and
+    check_refused(data, data.size(), data.size() - 1) and
+    check_refused(data, offsetof(dump_header, sections) + 3, data.size());
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  std::remove(DUMP_PATH);
+  }
@@ -0,0 +1,186 @@
+// tests/glif.cpp
+
+// compares the single-buffer glif serializer against the per-element string
+// reprs and reports the time taken per glyph by each, checks the streamed
+// and multi-lane hint ids against hashing the whole id string, and checks
+// glifs rendered into arenas by nested teams of more threads than the arenas
+// were sized for
+//
+// g++ -std=c++20 -O2 -fopenmp tests/glif.cpp -lz -o glif
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/glif.cpp"
+
+const size_t GLIFS = 2000;
+const size_t ROUNDS = 20;
+
+std::string point_repr(const cpp_outlines &outlines, size_t i) {
+  std::vector<std::string> attrs = {
+    attr("x", number_str(outlines.x[i])),
+    attr("y", number_str(outlines.y[i])),
+    };
+  if (outlines.types[i] & POINT_TYPE_MASK) {
+    attrs.push_back(attr("type", POINT_TYPES[outlines.types[i] & POINT_TYPE_MASK]));
+    if (outlines.types[i] & POINT_SMOOTH)
+      attrs.push_back(attr("smooth", "yes"));
+    if (outlines.hintsets.count(i))
+      attrs.push_back(attr("name", fmt::format("hintSet{:04}", outlines.hintsets.at(i))));
+    }
+  return fmt::format("\t\t\t<point {}/>\n", attrs_str(attrs));
+  }
+
+std::string outline_repr(const cpp_glif &glif, const cpp_outlines &outlines) {
+  std::string repr;
+  for (const auto &anchor : glif.anchors)
+    repr += anchor.repr();
+  for (const auto &component : glif.components)
+    repr += component.repr();
+  for (size_t contour = glif.outline.start; contour < glif.outline.end; contour++) {
+    repr += "\t\t<contour>\n";
+    for (size_t i = outlines.start(contour); i < outlines.end(contour); i++)
+      repr += point_repr(outlines, i);
+    repr += "\t\t</contour>\n";
+    }
+  for (const auto &hint : glif.hhints)
+    repr += hint.repr() + hint.repr2();
+  for (const auto &hint : glif.vhints)
+    repr += hint.repr() + hint.repr2();
+  return repr;
+  }
+
+std::string hint_id_repr(const cpp_glif &glif, const cpp_outlines &outlines) {
+  std::string id = fmt::format(FMT_COMPILE("w'{}"), number_str(glif.width));
+  for (size_t contour = glif.outline.start; contour < glif.outline.end; contour++) {
+    if (outlines.end(contour) - outlines.start(contour) < 2)
+      continue;
+    for (size_t i = outlines.start(contour); i < outlines.end(contour); i++)
+      id += fmt::format(FMT_COMPILE("{}{},{}"), POINT_TYPES[outlines.types[i] & POINT_TYPE_MASK][0],
+        number_str(outlines.x[i]), number_str(outlines.y[i]));
+    }
+  if (id.size() > 128)
+    return sha512::hash(id);
+  return id;
+  }
+
+void outline_repr(fmt::memory_buffer &buf, const cpp_glif &glif, const cpp_outlines &outlines) {
+  for (const auto &anchor : glif.anchors)
+    anchor_repr(buf, anchor);
+  for (const auto &component : glif.components)
+    component_repr(buf, component);
+  contours_repr(buf, outlines, glif.outline);
+  for (const auto &hint : glif.hhints) {
+    hint_repr(buf, hint);
+    hint_repr2(buf, hint);
+    }
+  for (const auto &hint : glif.vhints) {
+    hint_repr(buf, hint);
+    hint_repr2(buf, hint);
+    }
+  }
+
+std::vector<cpp_glif> build_glifs(cpp_outlines &outlines) {
+  std::mt19937 rng(1);
+  auto coord = [&rng]() {
+    return (float) ((int) (rng() % 4000) - 2000) + (rng() % 4 ? 0.0f : (rng() % 10) / 10.0f);
+    };
+
+  std::vector<cpp_glif> glifs;
+  glifs.reserve(GLIFS);
+  for (size_t i = 0; i < GLIFS; i++) {
+    cpp_glif glif("glif" + std::to_string(i), "", 0, coord(), i, 0, false, false);
+    glif.anchors.emplace_back("top", coord(), coord());
+    glif.components.emplace_back("base", 0, coord(), coord(), 1.0f, 0.5f);
+    glif.outline.start = outlines.contours.size();
+    for (size_t j = 0; j < i % 5; j++) {
+      outlines.add_contour();
+      outlines.add_point(coord(), coord(), 1, 0, (int) j);
+      for (size_t k = 0; k < rng() % 40; k++)
+        outlines.add_point(coord(), coord(), (int) (rng() % 4), (int) (rng() % 2));
+      }
+    glif.outline.end = outlines.contours.size();
+    glif.len_points = outlines.start(glif.outline.end) - outlines.start(glif.outline.start);
+    glif.hhints.emplace_back(coord(), coord(), false, false);
+    glif.vhints.emplace_back(coord(), coord(), true, false);
+    glifs.push_back(glif);
+    }
+  return glifs;
+  }
+
+int main() {
+  cpp_outlines outlines;
+  auto glifs = build_glifs(outlines);
+
+  std::cout << "buffer repr matches string repr\n";
+  bool pass = true;
+  for (const auto &glif : glifs) {
+    fmt::memory_buffer buf;
+    outline_repr(buf, glif, outlines);
+    if (fmt::to_string(buf) != outline_repr(glif, outlines))
+      pass = false;
+    }
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  cpp_ufo ufo;
+  ufo.glifs = glifs;
+  ufo.outlines = outlines;
+  ufo.hint_type = 3;
+  build_hint_ids(ufo);
+
+  std::cout << "streamed and multi-lane hint ids match hashing the id string\n";
+  pass = true;
+  for (const auto &glif : glifs) {
+    auto expected = hint_id_repr(glif, outlines);
+    if (glif.hint_id(outlines) != expected or ufo.hint_ids.at(glif.index) != expected)
+      pass = false;
+    }
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  std::cout << "glifs rendered into arenas match their repr\n";
+  arena_pool arenas;
+  std::vector<std::string_view> rendered(glifs.size());
+  // two nested teams, whose threads are numbered alike within each team
+  omp_set_max_active_levels(2);
+  #pragma omp parallel num_threads(2)
+  {
+    size_t team = omp_get_thread_num();
+    #pragma omp parallel for num_threads(omp_get_max_threads())
+    for (size_t i = team; i < glifs.size(); i += 2)
+      rendered[i] = arena_repr(ufo.glifs[i], ufo, arenas);
+    }
+  pass = true;
+  for (size_t i = 0; i < glifs.size(); i++)
+    if (rendered[i] != ufo.glifs[i].repr(ufo))
+      pass = false;
+  arenas.release();
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  size_t total = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < ROUNDS; i++)
+    for (const auto &glif : glifs)
+      total += outline_repr(glif, outlines).size();
+  auto string_time = std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  fmt::memory_buffer buf;
+  for (size_t i = 0; i < ROUNDS; i++)
+    for (const auto &glif : glifs) {
+      buf.clear();
+      outline_repr(buf, glif, outlines);
+      total -= buf.size();
+      }
+  auto buffer_time = std::chrono::steady_clock::now() - start;
+
+  auto per_glif = [](auto time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / (GLIFS * ROUNDS);
+    };
+  std::cout << fmt::format("string repr: {} ns/glif\n", per_glif(string_time));
+  std::cout << fmt::format("buffer repr: {} ns/glif\n", per_glif(buffer_time));
+  if (total != 0)
+    std::cout << "fail\n";
+  }
@@ -0,0 +1,252 @@
+// tests/kern.cpp
+
+// fills cpp_kerning with random pairs of a mock font and checks its sorted
+// pairs and kerning.plist against the nested sorted maps _kerning() in
+// kern.pyx built: pairs ordered by glyph name, key glyphs written as their
+// kerning groups, and the greatest value of a repeated pair kept, as sorting
+// the (second, value) pairs into a dict did; then checks that the kern
+// feature has every pair above the minimum value, that each class subtable
+// fits its offsets, and that a first group too large for any subtable is
+// reported
+//
+// g++ -std=c++20 -O2 tests/kern.cpp -o kern
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../src/kern.cpp"
+
+const size_t GLYPHS = 3000;
+const size_t PAIRS = 300000;
+const long MIN_VALUE = 5;
+
+struct mock_font {
+  std::vector<std::string> names;
+  std::vector<std::string> firsts;
+  std::vector<std::string> seconds;
+  std::vector<size_t> first_sizes;
+  std::vector<size_t> second_sizes;
+  std::vector<cpp_kern_pair> pairs;
+  };
+
+// glyph names in font order, not name order; every 7th glyph is the key
+// glyph of a first group and every 11th of a second group
+mock_font mock_font_kerning(std::mt19937 &rng) {
+  mock_font font;
+  std::uniform_int_distribution<size_t> glyph(0, GLYPHS - 1);
+  std::uniform_int_distribution<long> value(-150, 150);
+  for (size_t i = 0; i < GLYPHS; i++) {
+    std::string name = "g" + std::to_string((i * 7919) % GLYPHS);
+    if (i % 5 == 0)
+      name = "uni" + std::to_string(10000 + i);
+    font.names.push_back(name);
+    font.firsts.push_back(i % 7 == 0 ? "public.kern1." + name : name);
+    font.seconds.push_back(i % 11 == 0 ? "public.kern2." + name : name);
+    font.first_sizes.push_back(i % 7 == 0 ? i % 13 + 2 : 0);
+    font.second_sizes.push_back(i % 11 == 0 ? i % 17 + 2 : 0);
+    }
+  for (size_t i = 0; i < PAIRS; i++)
+    font.pairs.push_back({glyph(rng), glyph(rng), value(rng)});
+  return font;
+  }
+
+// pairs sorted by first and second glyph name, then mapped to groups; the
+// (second, value) pairs of each first were sorted before they were set in a
+// dict, so a repeated pair is left with its greatest value
+std::vector<std::tuple<std::string, std::string, long>> expected_pairs(const mock_font &font) {
+  std::map<std::string, std::map<std::string, std::pair<size_t, long>>> sorted;
+  for (const auto &pair : font.pairs) {
+    auto [it, added] = sorted[font.names[pair.first]].try_emplace(font.names[pair.second], pair.second, pair.value);
+    if (not added)
+      it->second.second = std::max(it->second.second, pair.value);
+    }
+
+  std::map<std::string, size_t> index;
+  for (size_t i = 0; i < font.names.size(); i++)
+    index.emplace(font.names[i], i);
+
+  std::vector<std::tuple<std::string, std::string, long>> pairs;
+  for (const auto &[first, seconds] : sorted)
+    for (const auto &[second, value] : seconds)
+      pairs.emplace_back(font.firsts[index[first]], font.seconds[value.first], value.second);
+  return pairs;
+  }
+
+std::string expected_plist(const std::vector<std::tuple<std::string, std::string, long>> &pairs) {
+  cpp_plist plist;
+  plist.begin_dict();
+  for (size_t i = 0; i < pairs.size(); i++) {
+    const auto &[first, second, value] = pairs[i];
+    if (i == 0 or first != std::get<0>(pairs[i - 1])) {
+      if (i)
+        plist.end_dict();
+      plist.add_key(first);
+      plist.begin_dict();
+      }
+    plist.add_key(second);
+    plist.add_integer(value);
+    }
+  if (pairs.size())
+    plist.end_dict();
+  plist.end_dict();
+  return plist.finish();
+  }
+
+// class pair lines of each class subtable of a kern feature, and every other
+// line after the subtables are taken out
+struct feature_lines {
+  std::vector<std::vector<std::string>> subtables;
+  std::multiset<std::string> lines;
+  };
+
+feature_lines split_feature(const std::string &feature) {
+  feature_lines split;
+  std::istringstream text(feature);
+  std::string line;
+  bool subtable = true;
+  while (std::getline(text, line)) {
+    line.erase(0, line.find_first_not_of('\t'));
+    if (line.rfind("pos @", 0) == 0 and line.find(" @", 4) != std::string::npos) {
+      if (subtable)
+        split.subtables.emplace_back();
+      split.subtables.back().push_back(line);
+      subtable = false;
+      }
+    else if (line == "subtable;")
+      subtable = true;
+    else if (line.rfind("pos ", 0) == 0 or line.rfind("enum pos ", 0) == 0)
+      split.lines.insert(line);
+    }
+  return split;
+  }
+
+bool check_feature(const mock_font &font, const cpp_kern_feature &feature,
+    const std::vector<std::tuple<std::string, std::string, long>> &pairs) {
+  std::map<std::string, size_t> sizes;
+  for (size_t i = 0; i < font.names.size(); i++) {
+    sizes[font.firsts[i]] = font.first_sizes[i];
+    sizes[font.seconds[i]] = font.second_sizes[i];
+    }
+
+  std::multiset<std::string> expected;
+  for (const auto &[first, second, value] : pairs) {
+    if (std::abs(value) < MIN_VALUE)
+      continue;
+    std::string a = sizes[first] ? "@" + first : first;
+    std::string b = sizes[second] ? "@" + second : second;
+    std::string pos = (sizes[first] != 0) xor (sizes[second] != 0) ? "enum pos " : "pos ";
+    expected.insert(pos + a + " " + b + " " + std::to_string(value) + ";");
+    }
+
+  feature_lines split = split_feature(feature.lines);
+  std::set<std::string> placed;
+  for (const auto &subtable : split.subtables) {
+    std::set<std::string> firsts, seconds;
+    for (const auto &line : subtable) {
+      split.lines.insert(line);
+      std::istringstream words(line);
+      std::string pos, first, second;
+      words >> pos >> first >> second;
+      firsts.insert(first.substr(1));
+      seconds.insert(second.substr(1));
+      }
+    size_t first_glyphs = 0, second_glyphs = 0;
+    for (const auto &first : firsts) {
+      // a first group is never split across subtables
+      if (not placed.insert(first).second)
+        return false;
+      first_glyphs += sizes[first];
+      }
+    for (const auto &second : seconds)
+      second_glyphs += sizes[second];
+    if (kern_subtable_size(firsts.size(), seconds.size(), first_glyphs, second_glyphs) > KERN_SUBTABLE_LIMIT)
+      return false;
+    }
+  // the extension lookup is left to fea_lookup() in kern.pyx
+  bool lookup = feature.lines.find("lookup") != std::string::npos;
+  return split.subtables.size() > 1 and feature.subtables == split.subtables.size() and
+    not lookup and feature.oversize.empty() and split.lines == expected;
+  }
+
+// a first group kerned against more second groups than one subtable can
+// hold, and a small one that fits
+bool check_oversize() {
+  const size_t glyphs = 12000;
+  std::vector<std::string> names, firsts, seconds;
+  std::vector<size_t> first_sizes, second_sizes;
+  std::vector<cpp_kern_pair> pairs;
+  for (size_t i = 0; i < glyphs; i++) {
+    names.push_back("g" + std::to_string(i));
+    firsts.push_back(i < 2 ? "public.kern1." + names.back() : names.back());
+    seconds.push_back("public.kern2." + names.back());
+    first_sizes.push_back(i < 2 ? 2 : 0);
+    second_sizes.push_back(1);
+    pairs.push_back({0, i, 10});
+    }
+  pairs.push_back({1, 0, 10});
+
+  cpp_kerning kerning;
+  kerning.set_glyphs(names, firsts, seconds);
+  kerning.set_groups(first_sizes, second_sizes);
+  kerning.add_pairs(pairs);
+  kerning.sort();
+  cpp_kern_feature feature = kerning.feature(MIN_VALUE);
+  feature_lines split = split_feature(feature.lines);
+  return feature.oversize == std::vector<std::string>{"public.kern1.g0"} and
+    feature.subtables == 2 and split.subtables.size() == 2 and
+    split.subtables[0].size() + split.subtables[1].size() == glyphs + 1;
+  }
+
+int main() {
+  std::mt19937 rng(1);
+  mock_font font = mock_font_kerning(rng);
+
+  auto start = std::chrono::steady_clock::now();
+  cpp_kerning kerning;
+  kerning.set_glyphs(font.names, font.firsts, font.seconds);
+  kerning.set_groups(font.first_sizes, font.second_sizes);
+  kerning.add_pairs(font.pairs);
+  kerning.sort();
+  std::string plist = kerning.plist();
+  cpp_kern_feature feature = kerning.feature(MIN_VALUE);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  auto expected = expected_pairs(font);
+  bool pass = kerning.size() == expected.size();
+  for (size_t i = 0; pass and i < expected.size(); i++) {
+    const auto &record = kerning.records[i];
+    pass = kerning.first(record) == std::get<0>(expected[i]) and
+      kerning.second(record) == std::get<1>(expected[i]) and
+      record.value == std::get<2>(expected[i]);
+    }
+  std::cout << "pairs are sorted by glyph name and keep their greatest value\n";
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  cpp_kerning repeated;
+  repeated.set_glyphs(font.names, font.firsts, font.seconds);
+  repeated.add_pairs({{3, 4, 20}, {3, 4, 50}, {3, 5, -10}, {3, 4, -30}, {3, 5, -40}});
+  repeated.sort();
+  std::cout << "a pair added more than once keeps its greatest value, not its last\n";
+  pass = repeated.size() == 2 and
+    repeated.records[0].value == (font.names[4] < font.names[5] ? 50 : -10) and
+    repeated.records[1].value == (font.names[4] < font.names[5] ? -10 : 50);
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  std::cout << "kerning.plist matches the sorted pairs\n";
+  std::cout << (plist == expected_plist(expected) ? "pass\n" : "fail\n");
+
+  std::cout << "kern feature has every pair and its subtables fit\n";
+  std::cout << (check_feature(font, feature, expected) ? "pass\n" : "fail\n");
+
+  std::cout << "a first group too large for one subtable is kept whole and reported\n";
+  std::cout << (check_oversize() ? "pass\n" : "fail\n");
+
+  std::cout << PAIRS << " pairs sorted and written in " << elapsed.count() << " s\n";
+  }
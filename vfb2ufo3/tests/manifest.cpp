@@ -0,0 +1,102 @@
+// tests/manifest.cpp
+
+// writes mock glifs to a temporary directory through a file_writer with a
+// cpp_manifest, then rebuilds: an unchanged rebuild writes nothing and keeps
+// modification times, a changed glif is the only file written, and a glif
+// no longer produced is removed; then checks unchanged() on a file written
+// with write_output_file, whose size on disk must be the size of its data
+//
+// g++ -std=c++20 -O2 -fopenmp tests/manifest.cpp -lz -o manifest
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "../src/output.cpp"
+
+const size_t GLIFS = 2000;
+
+std::vector<std::pair<std::string, std::string>> mock_glifs(const std::string &dir, size_t n) {
+  std::vector<std::pair<std::string, std::string>> glifs;
+  for (size_t i = 0; i < n; i++)
+    glifs.emplace_back(
+      dir + "/glyph" + std::to_string(i) + ".glif",
+      "<glyph name=\"glyph" + std::to_string(i) + "\" format=\"2\">\n</glyph>\n");
+  return glifs;
+  }
+
+// returns the number of files written by this run
+size_t build(const std::string &manifest_path, const std::vector<std::pair<std::string, std::string>> &glifs) {
+  cpp_manifest manifest(manifest_path);
+  file_writer writer;
+  writer.manifest = &manifest;
+  for (const auto &[path, data] : glifs)
+    writer.add(path, std::string(data));
+  writer.flush();
+  bool ok = writer.errors.empty() and manifest.finish().empty();
+  return ok ? manifest.written : (size_t) -1;
+  }
+
+struct timespec modified(const std::string &path) {
+  struct stat st = {};
+  ::stat(path.c_str(), &st);
+  return st.st_mtim;
+  }
+
+bool exists(const std::string &path) {
+  struct stat st;
+  return ::stat(path.c_str(), &st) == 0;
+  }
+
+int main() {
+  char dir_template[] = "/tmp/vfb2ufo3_manifestXXXXXX";
+  std::string dir = ::mkdtemp(dir_template);
+  std::string manifest_path = dir + ".manifest";
+  auto glifs = mock_glifs(dir, GLIFS);
+
+  std::cout << "first build writes every file\n";
+  std::cout << (build(manifest_path, glifs) == GLIFS ? "pass\n" : "fail\n");
+
+  auto before = modified(glifs[0].first);
+  std::cout << "unchanged rebuild writes nothing and keeps modification times\n";
+  bool pass = build(manifest_path, glifs) == 0;
+  auto after = modified(glifs[0].first);
+  pass = pass and before.tv_sec == after.tv_sec and before.tv_nsec == after.tv_nsec;
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  glifs[7].second += "<!-- changed -->\n";
+  std::cout << "only a changed file is written\n";
+  std::cout << (build(manifest_path, glifs) == 1 ? "pass\n" : "fail\n");
+
+  // a file truncated on disk is written again even though its contents did not change
+  ::truncate(glifs[9].first.c_str(), 0);
+  std::cout << "a file changed on disk is written again\n";
+  std::cout << (build(manifest_path, glifs) == 1 ? "pass\n" : "fail\n");
+
+  std::string removed = glifs.back().first;
+  glifs.pop_back();
+  std::cout << "a file no longer produced is removed\n";
+  std::cout << (build(manifest_path, glifs) == 0 and not exists(removed) ? "pass\n" : "fail\n");
+
+  // line endings are written as given, so the recorded size is the size on disk
+  std::string written = dir + "/written.glif";
+  std::string data = "<glyph name=\"written\" format=\"2\">\n</glyph>\n";
+  manifest_entry entry(data);
+  pass = write_output_file(written, data) == 0;
+  {
+    cpp_manifest manifest(manifest_path);
+    manifest.add(written, entry, true);
+    pass = pass and manifest.finish().empty();
+    }
+  cpp_manifest reread(manifest_path);
+  pass = pass and reread.unchanged(written, entry);
+  std::string crlf = "<glyph name=\"written\" format=\"2\">\r\n</glyph>\r\n";
+  pass = pass and write_output_file(written, crlf) == 0 and not reread.unchanged(written, entry);
+  std::cout << "a written file is unchanged only while its size on disk matches\n";
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  std::system(("rm -rf '" + dir + "' '" + manifest_path + "'").c_str());
+  }
@@ -0,0 +1,124 @@
+// tests/mark.cpp
+
+// indexes the anchors of mock glifs with cpp_marks and checks the mark
+// feature against the one _mark_feature() in mark.pyx built from the same
+// anchors: sorted unique mark classes, a lookup of sorted base positions for
+// each base anchor, and the lookup references
+//
+// g++ -std=c++20 -O2 -fopenmp tests/mark.cpp -o mark
+
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../src/mark.cpp"
+
+const size_t GLYPHS = 4000;
+
+const std::vector<std::string> ANCHORS = {
+  "top", "bottom", "center", "ogonek", "horn", "caret", "nukta", "madda",
+  };
+
+// every glyph has a few anchors; some are mark anchors, some have no name
+// or an unknown name, and every 50th glyph is omitted
+std::vector<cpp_glif> mock_glifs(std::mt19937 &rng) {
+  std::uniform_int_distribution<int> coord(-300, 1500);
+  std::uniform_int_distribution<size_t> anchor(0, ANCHORS.size() + 1);
+  std::uniform_int_distribution<int> count(0, 4);
+  std::vector<cpp_glif> glifs;
+  for (size_t i = 0; i < GLYPHS; i++) {
+    std::string name = "glyph" + std::to_string((i * 7919) % GLYPHS);
+    cpp_glif glif(name, "glyphs/" + name + ".glif", 0, 500, i, 0, i % 50 == 0, false);
+    bool mark = i % 3 == 0;
+    for (int n = count(rng); n > 0; n--) {
+      size_t a = anchor(rng);
+      std::string anchor_name = a < ANCHORS.size() ? ANCHORS[a] : a == ANCHORS.size() ? "" : "unused";
+      if (mark and not anchor_name.empty())
+        anchor_name = "_" + anchor_name;
+      glif.anchors.emplace_back(anchor_name, coord(rng), coord(rng));
+      }
+    glifs.push_back(glif);
+    }
+  return glifs;
+  }
+
+// _mark_feature() over the same glifs
+std::string expected_feature(const std::vector<cpp_glif> &glifs,
+    const std::set<std::string> &mark_classes, const std::set<std::string> &mark_bases, double scale) {
+  auto coord = [scale](float value) { return (long) std::nearbyint(value * scale); };
+  std::set<std::string> classes;
+  std::map<std::string, std::vector<std::string>> bases;
+  for (const auto &glif : glifs) {
+    if (glif.omit)
+      continue;
+    for (const auto &anchor : glif.anchors) {
+      if (anchor.name.empty())
+        continue;
+      if (anchor.name[0] == '_' and mark_classes.count(anchor.name.substr(1))) {
+        classes.insert(fmt::format("\tmarkClass {} <anchor {} {}> @{};",
+          glif.name, coord(anchor.x), coord(anchor.y), anchor.name.substr(1)));
+        continue;
+        }
+      if (mark_classes.count(anchor.name) and mark_bases.count(anchor.name))
+        bases[anchor.name].push_back(fmt::format("\tpos base {} <anchor {} {}> mark @{};",
+          glif.name, coord(anchor.x), coord(anchor.y), anchor.name));
+      }
+    }
+  if (bases.empty())
+    return std::string();
+
+  std::vector<std::string> feature;
+  std::string text;
+  for (const auto &line : classes)
+    text += (text.empty() ? "" : "\n") + line;
+  feature.push_back(text);
+  size_t i = 1;
+  for (auto &[name, lines] : bases) {
+    std::sort(lines.begin(), lines.end());
+    text = fmt::format("\tlookup mark{} {{", i);
+    for (const auto &line : lines)
+      text += "\n\t" + line;
+    text += fmt::format("\n\t}} mark{};", i++);
+    feature.push_back(text);
+    }
+  text.clear();
+  for (size_t j = 1; j < i; j++)
+    text += fmt::format("{}\tlookup mark{};", j > 1 ? "\n" : "", j);
+  feature.push_back(text);
+
+  std::string joined;
+  for (size_t j = 0; j < feature.size(); j++)
+    joined += (j ? "\n" : "") + feature[j];
+  return joined;
+  }
+
+int main() {
+  std::mt19937 rng(1);
+  auto glifs = mock_glifs(rng);
+
+  // "madda" has marks but no bases, and "nukta" has no lookup
+  std::set<std::string> mark_classes = {"top", "bottom", "center", "ogonek", "horn", "nukta", "madda"};
+  std::set<std::string> mark_bases = {"top", "bottom", "center", "ogonek", "horn", "caret"};
+
+  for (double scale : {1.0, 0.512, 2.048}) {
+    cpp_marks marks;
+    marks.set_anchors(
+      std::vector<std::string>(mark_classes.begin(), mark_classes.end()),
+      std::vector<std::string>(mark_bases.begin(), mark_bases.end()));
+    marks.scan(glifs);
+    std::string feature = marks.feature(scale);
+    std::cout << "mark feature matches _mark_feature() at scale " << scale << "\n";
+    bool pass = not feature.empty() and feature == expected_feature(glifs, mark_classes, mark_bases, scale);
+    std::cout << (pass ? "pass\n" : "fail\n");
+    }
+
+  cpp_marks marks;
+  marks.set_anchors({"none"}, {"none"});
+  marks.scan(glifs);
+  std::cout << "no mark feature without bases\n";
+  std::cout << (marks.feature(1.0).empty() ? "pass\n" : "fail\n");
+  }
@@ -0,0 +1,168 @@
+// tests/nodes.cpp
+
+// reads mock FontLab glyphs into node buffers as glif_nodes() in glif.pyx
+// does and checks that cpp_outlines::add_nodes builds the same points, types
+// and hint sets as building the contours node by node
+//
+// glif_nodes() itself is not driven here: glif.pyx imports FL and builds only
+// as a Python 2.7 extension for FontLab, so the mock glyphs are read by a copy
+// of its loop, which has to be kept in step with it
+//
+// g++ -std=c++20 -O2 -fopenmp tests/nodes.cpp -lz -o nodes
+
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "../src/glif.cpp"
+
+const size_t GLYPHS = 2000;
+
+// node of a mock FontLab glyph; points[0] is node.x/node.y, and a curve node
+// has its two off-curve points in points[1] and points[2]
+struct mock_node {
+  int type = 1;
+  int count = 1;
+  int alignment = 0;
+  std::vector<cpp_point> points;
+  };
+
+struct mock_glyph {
+  std::vector<mock_node> nodes;
+  std::set<size_t> replacement_nodes = {0};
+  };
+
+// a glyph of closed contours mixing lines, curves and quadratic runs; some
+// curves end on the first point of their contour
+mock_glyph mock_font_glyph(std::mt19937 &rng) {
+  std::uniform_int_distribution<int> coord(-200, 1200);
+  std::uniform_int_distribution<int> contours(1, 4);
+  std::uniform_int_distribution<int> nodes(2, 30);
+  std::uniform_int_distribution<int> kind(0, 9);
+  auto point = [&]() { return cpp_point(coord(rng), coord(rng)); };
+
+  mock_glyph glyph;
+  for (int c = contours(rng); c > 0; c--) {
+    mock_node move;
+    move.type = NODE_MOVE;
+    move.alignment = kind(rng) & 1;
+    move.points = {point()};
+    glyph.nodes.push_back(move);
+    for (int n = nodes(rng); n > 0; n--) {
+      mock_node node;
+      int k = kind(rng);
+      node.alignment = k & 1;
+      if (k < 4) {
+        node.type = 35;
+        node.count = 3;
+        node.points = {n == 1 and k < 2 ? move.points[0] : point(), point(), point()};
+        }
+      else if (k < 6) {
+        node.type = NODE_OFF;
+        node.points = {point()};
+        }
+      else {
+        node.type = 1;
+        node.points = {point()};
+        }
+      glyph.nodes.push_back(node);
+      if (k == 9)
+        glyph.replacement_nodes.insert(glyph.nodes.size() - 1);
+      }
+    }
+  return glyph;
+  }
+
+void glif_nodes(const mock_glyph &glyph, cpp_nodes &nodes, bool hints) {
+  nodes.clear();
+  for (const auto &node : glyph.nodes)
+    if (node.count > 1)
+      nodes.add_node(node.type, node.alignment,
+        node.points[0].x, node.points[0].y,
+        node.points[1].x, node.points[1].y,
+        node.points[2].x, node.points[2].y);
+    else
+      nodes.add_node(node.type, node.alignment, node.points[0].x, node.points[0].y);
+  if (hints)
+    for (auto i : glyph.replacement_nodes)
+      nodes.add_replacement(i);
+  }
+
+// the contours of a glyph built node by node, with a set lookup per node
+cpp_outline glif_contours(const mock_glyph &glyph, cpp_outlines &outlines, bool hints) {
+  cpp_outline outline;
+  bool off = false, cubic = true;
+  cpp_point start_node(0, 0);
+  auto add = [&](size_t i, const cpp_point &p, int type, int alignment) {
+    if (hints and glyph.replacement_nodes.count(i))
+      outlines.add_point(p.x, p.y, type, alignment, i);
+    else
+      outlines.add_point(p.x, p.y, type, alignment);
+    };
+
+  outline.start = outlines.contours.size();
+  outlines.add_contour();
+  for (size_t i = 0; i < glyph.nodes.size(); i++) {
+    const auto &node = glyph.nodes[i];
+    if (node.type == NODE_MOVE) {
+      start_node = node.points[0];
+      if (outlines.x.size() != outlines.contours.back())
+        outlines.add_contour();
+      }
+    if (node.count > 1) {
+      cubic = true;
+      outlines.add_point(node.points[1].x, node.points[1].y);
+      outlines.add_point(node.points[2].x, node.points[2].y);
+      if (start_node.x == node.points[0].x and start_node.y == node.points[0].y) {
+        if (hints and glyph.replacement_nodes.count(i))
+          outlines.set_point(outlines.contours.back(), node.points[0].x, node.points[0].y, 1, node.alignment, i);
+        else
+          outlines.set_point(outlines.contours.back(), node.points[0].x, node.points[0].y, 1, node.alignment);
+        }
+      else
+        add(i, node.points[0], 1, node.alignment);
+      }
+    else if (node.type == NODE_OFF) {
+      off = true;
+      cubic = false;
+      outlines.add_point(node.points[0].x, node.points[0].y);
+      }
+    else if (cubic)
+      add(i, node.points[0], 3, node.alignment);
+    else if (off) {
+      outlines.add_point(node.points[0].x, node.points[0].y, 2);
+      off = false;
+      }
+    else
+      add(i, node.points[0], 3, 0);
+    }
+  outline.end = outlines.contours.size();
+  return outline;
+  }
+
+bool same_outlines(const cpp_outlines &a, const cpp_outlines &b) {
+  return a.x == b.x and a.y == b.y and a.types == b.types and
+    a.contours == b.contours and a.hintsets == b.hintsets;
+  }
+
+int main() {
+  std::mt19937 rng(1);
+  std::vector<mock_glyph> glyphs;
+  for (size_t i = 0; i < GLYPHS; i++)
+    glyphs.push_back(mock_font_glyph(rng));
+
+  for (bool hints : {false, true}) {
+    cpp_outlines expected, built;
+    cpp_nodes nodes;
+    bool pass = true;
+    for (const auto &glyph : glyphs) {
+      cpp_outline a = glif_contours(glyph, expected, hints);
+      glif_nodes(glyph, nodes, hints);
+      cpp_outline b = built.add_nodes(nodes, hints);
+      pass = pass and a.start == b.start and a.end == b.end;
+      }
+    std::cout << "node buffers build the same contours" << (hints ? " and hint sets\n" : "\n");
+    std::cout << (pass and same_outlines(expected, built) ? "pass\n" : "fail\n");
+    }
+  }
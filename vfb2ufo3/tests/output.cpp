@@ -0,0 +1,68 @@
+// tests/output.cpp
+
+// writes more mock glifs than fit in one batch or one submission through a
+// file_writer, along with a file too large for a single write call to be
+// likely to finish it, and checks every file on disk against its data and
+// that a file which cannot be opened is reported; compiled with
+// FILE_IO_URING, also checks that the files went through io_uring where the
+// kernel supports it
+//
+// g++ -std=c++20 -O2 -fopenmp -DFILE_IO_URING tests/output.cpp -lz -o output
+// g++ -std=c++20 -O2 -fopenmp tests/output.cpp -lz -o output
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/output.cpp"
+
+const size_t GLIFS = 3000;
+
+std::string read(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream data;
+  data << file.rdbuf();
+  return data.str();
+  }
+
+int main() {
+  char dir_template[] = "/tmp/vfb2ufo3_outputXXXXXX";
+  std::string dir = ::mkdtemp(dir_template);
+
+  std::vector<std::pair<std::string, std::string>> files;
+  for (size_t i = 0; i < GLIFS; i++) {
+    std::string data = "<glyph name=\"glyph" + std::to_string(i) + "\" format=\"2\">\n";
+    for (size_t j = 0; j < i % 50; j++)
+      data += "\t<point x=\"" + std::to_string(i * j % 997) + "\" y=\"" + std::to_string(j) + "\"/>\n";
+    files.emplace_back(dir + "/glyph" + std::to_string(i) + ".glif", data + "</glyph>\n");
+    }
+  files.emplace_back(dir + "/large.plist", std::string(64 << 20, 'x'));
+
+  file_writer writer;
+  for (const auto &[path, data] : files)
+    writer.add(path, std::string_view(data));
+  writer.add(dir + "/missing/glyph.glif", std::string("<glyph/>\n"));
+  writer.flush();
+
+#ifdef FILE_IO_URING
+  if (writer.uring)
+    std::cout << "files are written through io_uring\n";
+  else
+    std::cout << "io_uring is not supported here, files are written with plain calls\n";
+#endif
+
+  std::cout << "every file on disk has its data\n";
+  bool pass = true;
+  for (const auto &[path, data] : files)
+    pass = pass and read(path) == data;
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  std::cout << "a file that cannot be opened is reported\n";
+  pass = writer.errors.size() == 1 and writer.errors[0].starts_with(dir + "/missing/glyph.glif: ");
+  std::cout << (pass ? "pass\n" : "fail\n");
+
+  std::system(("rm -rf '" + dir + "'").c_str());
+  }
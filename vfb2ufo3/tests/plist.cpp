@@ -0,0 +1,148 @@
+// tests/plist.cpp
+
+// writes a plist with every value type through cpp_plist and checks it
+// against the layout plist_doc() in includes/xml.pxi gives the same values,
+// and that keys and strings are escaped
+//
+// g++ -std=c++20 -O2 tests/plist.cpp -o plist
+
+#include <iostream>
+#include <string>
+
+#include "../src/plist.cpp"
+
+// plist_doc() of the same values
+const std::string EXPECTED = R"(<?xml version="1.0" encoding="UTF-8"?>
+<!DOCTYPE plist PUBLIC "-//Apple Computer//DTD PLIST 1.0//EN"
+	"http://www.apple.com/DTDs/PropertyList-1.0.dtd">
+<plist version="1.0">
+<dict>
+	<key>creator</key>
+	<string>com.spiratype</string>
+	<key>formatVersion</key>
+	<integer>3</integer>
+	<key>italicAngle</key>
+	<real>-12.5</real>
+	<key>unitsPerEm</key>
+	<real>1000.0</real>
+	<key>big</key>
+	<real>1e+16</real>
+	<key>third</key>
+	<real>0.333333333333</real>
+	<key>flag</key>
+	<true/>
+	<key>off</key>
+	<false/>
+	<key>public.kern1.A</key>
+	<array>
+		<string>A</string>
+		<string>Agrave</string>
+		<string>Aacute</string>
+	</array>
+	<key>empty</key>
+	<array></array>
+	<key>nested</key>
+	<dict>
+	</dict>
+	<key>kerning</key>
+	<dict>
+		<key>A</key>
+		<dict>
+			<key>V</key>
+			<integer>-80</integer>
+			<key>public.kern2.O</key>
+			<integer>15</integer>
+		</dict>
+		<key>T</key>
+		<dict>
+			<key>o</key>
+			<integer>-120</integer>
+		</dict>
+	</dict>
+	<key>layers</key>
+	<array>
+		<array>
+			<string>public.default</string>
+			<string>glyphs</string>
+		</array>
+	</array>
+</dict>
+</plist>
+)";
+
+std::string write_plist() {
+  cpp_plist plist;
+  plist.begin_dict();
+  plist.add_key("creator");
+  plist.add_string("com.spiratype");
+  plist.add_key("formatVersion");
+  plist.add_integer(3);
+  plist.add_key("italicAngle");
+  plist.add_real(-12.5);
+  plist.add_key("unitsPerEm");
+  plist.add_real(1000.0);
+  plist.add_key("big");
+  plist.add_real(1e16);
+  plist.add_key("third");
+  plist.add_real(1.0 / 3.0);
+  plist.add_key("flag");
+  plist.add_bool(true);
+  plist.add_key("off");
+  plist.add_bool(false);
+  plist.add_key("public.kern1.A");
+  plist.begin_array();
+  for (auto name : {"A", "Agrave", "Aacute"})
+    plist.add_string(name);
+  plist.end_array();
+  plist.add_key("empty");
+  plist.begin_array();
+  plist.end_array();
+  plist.add_key("nested");
+  plist.begin_dict();
+  plist.end_dict();
+  plist.add_key("kerning");
+  plist.begin_dict();
+  plist.add_key("A");
+  plist.begin_dict();
+  plist.add_key("V");
+  plist.add_integer(-80);
+  plist.add_key("public.kern2.O");
+  plist.add_integer(15);
+  plist.end_dict();
+  plist.add_key("T");
+  plist.begin_dict();
+  plist.add_key("o");
+  plist.add_integer(-120);
+  plist.end_dict();
+  plist.end_dict();
+  plist.add_key("layers");
+  plist.begin_array();
+  plist.begin_array();
+  plist.add_string("public.default");
+  plist.add_string("glyphs");
+  plist.end_array();
+  plist.end_array();
+  plist.end_dict();
+  return plist.finish();
+  }
+
+std::string write_escaped() {
+  cpp_plist plist;
+  plist.begin_dict();
+  plist.add_key("a<b>&c");
+  plist.add_string("Smith & Sons <Foundry>");
+  plist.end_dict();
+  return plist.finish();
+  }
+
+int main() {
+  std::cout << "plist layout matches plist_doc()\n";
+  std::cout << (write_plist() == EXPECTED ? "pass\n" : "fail\n");
+
+  std::string escaped = write_escaped();
+  std::cout << "keys and strings are escaped\n";
+  bool pass =
+    escaped.find("\t<key>a&lt;b&gt;&amp;c</key>\n") != std::string::npos and
+    escaped.find("\t<string>Smith &amp; Sons &lt;Foundry&gt;</string>\n") != std::string::npos;
+  std::cout << (pass ? "pass\n" : "fail\n");
+  }
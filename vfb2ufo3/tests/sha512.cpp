@@ -1,17 +1,28 @@
 // tests/sha512.cpp
 
 // https://csrc.nist.gov/CSRC/media/Projects/Cryptographic-Standards-and-Guidelines/documents/examples/SHA512.pdf
+//
+// checks the NIST examples, checks the multi-lane batch against hashing each
+// message on its own for every lane count the CPU supports, and reports the
+// throughput of each on hint id sized messages
+//
+// g++ -std=c++20 -O2 -fopenmp tests/sha512.cpp -o sha512
 
 #define FMT_HEADER_ONLY
 #include <fmt/format.h>
 #include <fmt/compile.h>
 
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <random>
 #include <string>
+#include <vector>
 
-#include "../sha512.cpp"
+#include "../src/sha512.cpp"
+
+const size_t MESSAGES = 20000;
 
 const std::string abc1( "ddaf35a1" "93617aba" "cc417349" "ae204131"
   "12e6fa4e" "89a97ea2" "0a9eeee6" "4b55d39a" "2192992a" "274fc1a8"
@@ -27,25 +38,63 @@ const std::string qfox( "07e547d9" "586f6a73" "f73fbac0" "435ed769"
   );
 
 int main() {
-  auto test_abc1 = sha512::sha512_hash("abc");
-  auto test_abc2 = sha512::sha512_hash("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu");
-  auto test_qfox = sha512::sha512_hash("The quick brown fox jumps over the lazy dog");
+  auto test_abc1 = sha512::hash("abc");
+  auto test_abc2 = sha512::hash("abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu");
+  auto test_qfox = sha512::hash("The quick brown fox jumps over the lazy dog");
 
-  std::cout << "sha512::sha512_hash(\"abc\")" << '\n';
+  std::cout << "sha512::hash(\"abc\")" << '\n';
   if (test_abc1 == abc1)
     std::cout << "pass\n";
   else
     std::cout << "fail\n";
 
-  std::cout << "sha512::sha512_hash(\"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu\")\n";
+  std::cout << "sha512::hash(\"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu\")\n";
   if (test_abc2 == abc2)
     std::cout << "pass\n";
   else
     std::cout << "fail\n";
 
-  std::cout << "sha512::sha512_hash(\"The quick brown fox jumps over the lazy dog\")\n";
+  std::cout << "sha512::hash(\"The quick brown fox jumps over the lazy dog\")\n";
   if (test_qfox == qfox)
     std::cout << "pass\n";
   else
     std::cout << "fail\n";
+
+  // every length around the padding and block boundaries, then hint id sized
+  // messages of printable characters
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> chars(33, 126);
+  std::uniform_int_distribution<int> lengths(129, 8000);
+  std::vector<std::string> messages;
+  for (size_t size = 0; size < 400; size++)
+    messages.push_back(std::string(size, 'a' + size % 26));
+  while (messages.size() < MESSAGES) {
+    std::string message(lengths(rng), '\0');
+    for (auto &c : message)
+      c = chars(rng);
+    messages.push_back(message);
+    }
+
+  size_t bytes = 0;
+  for (const auto &message : messages)
+    bytes += message.size();
+
+  std::vector<std::string> expected(messages.size());
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < messages.size(); i++)
+    expected[i] = sha512::hash(messages[i]);
+  std::chrono::duration<double> scalar = std::chrono::steady_clock::now() - start;
+  std::cout << "sha512::hash, one message at a time, single thread: "
+    << bytes / scalar.count() / 1e6 << " MB/s\n";
+
+  for (size_t lanes : {1, 4, 8}) {
+    if (lanes > sha512::simd_lanes())
+      continue;
+    start = std::chrono::steady_clock::now();
+    auto digests = sha512::hash(messages, lanes);
+    std::chrono::duration<double> batch = std::chrono::steady_clock::now() - start;
+    std::cout << "sha512::hash, " << lanes << " lane(s): "
+      << bytes / batch.count() / 1e6 << " MB/s\n";
+    std::cout << (digests == expected ? "pass\n" : "fail\n");
+    }
   }
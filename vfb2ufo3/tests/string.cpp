@@ -0,0 +1,59 @@
+// tests/string.cpp
+
+// checks the buffer number formatters against the fmt based string versions
+// for every int16 value with each single-decimal fraction, the floats either
+// side of each, and quarter values that round to ties
+//
+// g++ -std=c++20 -O2 tests/string.cpp -o string
+
+#define FMT_HEADER_ONLY
+#include <fmt/format.h>
+#include <fmt/compile.h>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../src/string.cpp"
+
+size_t failures = 0;
+
+void check(double n) {
+  fmt::memory_buffer buf;
+  number_str(buf, n);
+  if (fmt::to_string(buf) != number_str(n)) {
+    if (failures++ < 10)
+      std::cout << fmt::format("number_str({}): {} != {}\n", n, fmt::to_string(buf), number_str(n));
+    }
+
+  buf.clear();
+  float_str(buf, n);
+  if (fmt::to_string(buf) != float_str(n)) {
+    if (failures++ < 10)
+      std::cout << fmt::format("float_str({}): {} != {}\n", n, fmt::to_string(buf), float_str(n));
+    }
+  }
+
+int main() {
+  std::cout << "number_str/float_str int16 with .0-.9 fractions\n";
+  for (int i = INT16_MIN; i <= INT16_MAX; i++)
+    for (int j = -9; j <= 9; j++) {
+      float n = i + j / 10.0f;
+      check(n);
+      check((double) i + j / 10.0);
+      check(std::nextafter(n, -INFINITY));
+      check(std::nextafter(n, INFINITY));
+      }
+  // quarters round to a tie at one decimal place
+  for (int i = INT16_MIN; i <= INT16_MAX; i++)
+    for (int j = -3; j <= 3; j++)
+      check(i + j / 4.0);
+  for (double n : {0.05, -0.05, 0.049999, -0.049999, 1e12, -1e12, (double) INFINITY, (double) -INFINITY, (double) NAN})
+    check(n);
+  std::cout << (failures ? "fail\n" : "pass\n");
+  }
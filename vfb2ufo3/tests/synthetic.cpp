@@ -0,0 +1,108 @@
+// tests/synthetic.cpp
+
+// synthetic cpp_ufo fonts for benchmarks
+//
+// the first base_ratio of the glyphs are plain outlines used as component
+// bases; every other glyph has components with probability components, and
+// hinted glyphs have hint replacements with probability replacements
+
+#pragma once
+
+#include <random>
+#include <string>
+
+#include "../src/glif.cpp"
+
+struct synthetic_options {
+  size_t glyphs = 3000;
+  size_t points = 60;
+  size_t contour_points = 20;
+  double base_ratio = 0.1;
+  double components = 0.3;
+  double hints = 0.8;
+  double replacements = 0.2;
+  double offcurve = 0.5;
+  double curve = 0.2;
+  double qcurve = 0.05;
+  int hint_type = 3;
+  bool optimize = false;
+  unsigned seed = 1;
+  };
+
+void synthetic_font(cpp_ufo &ufo, const synthetic_options &options) {
+  std::mt19937 rng(options.seed);
+  std::uniform_real_distribution<double> chance(0.0, 1.0);
+  std::uniform_int_distribution<int> coord(-2000, 2000);
+  std::uniform_int_distribution<int> tenths(0, 9);
+
+  auto number = [&]() {
+    return (float) coord(rng) + (chance(rng) < 0.25 ? tenths(rng) / 10.0f : 0.0f);
+    };
+  auto point_type = [&]() {
+    double n = chance(rng);
+    if (n < options.offcurve)
+      return 0;
+    if (n < options.offcurve + options.curve)
+      return 1;
+    if (n < options.offcurve + options.curve + options.qcurve)
+      return 2;
+    return 3;
+    };
+
+  size_t n_bases = std::max<size_t>(options.glyphs * options.base_ratio, 1);
+  ufo.hint_type = options.hint_type;
+  ufo.optimize = options.optimize;
+  ufo.ufoz = false;
+  ufo.reserve(options.glyphs);
+  ufo.outlines.reserve(options.glyphs * (options.points / options.contour_points + 1), options.glyphs * options.points);
+
+  for (size_t i = 0; i < options.glyphs; i++) {
+    std::string name = "glyph" + std::to_string(i);
+    cpp_glif glif(name, "synthetic.ufo/glyphs/" + name + ".glif", i % 8, number() / 4 + 600, i, 0, false, i < n_bases);
+    glif.code_points.push_back(0x4e00 + i);
+    if (chance(rng) < 0.3)
+      glif.anchors.emplace_back("top", number(), number());
+
+    bool has_components = i >= n_bases and chance(rng) < options.components;
+    if (has_components) {
+      glif.components.emplace_back("glyph" + std::to_string(i % n_bases), i % n_bases, 0, 0, 0, 0);
+      size_t base = (i * 7) % n_bases;
+      glif.components.emplace_back("glyph" + std::to_string(base), base, number() / 10, number() / 10, 0, 0);
+      }
+
+    bool has_replacements = false;
+    if (chance(rng) < options.hints) {
+      size_t n_hints = 2 + rng() % 6;
+      for (size_t j = 0; j < n_hints; j++) {
+        glif.vhints.emplace_back(std::abs(number()) / 20 + 10, number(), true, false);
+        glif.hhints.emplace_back(std::abs(number()) / 20 + 10, number(), false, false);
+        }
+      if (chance(rng) < options.replacements) {
+        has_replacements = true;
+        for (size_t j = 0; j < n_hints; j += 2) {
+          glif.hint_replacements.emplace_back(255, j * 4);
+          glif.hint_replacements.emplace_back(1, j);
+          glif.hint_replacements.emplace_back(2, j);
+          }
+        }
+      }
+
+    if (not has_components) {
+      glif.outline.start = ufo.outlines.contours.size();
+      for (size_t j = 0; j < options.points; j++) {
+        if (j % options.contour_points == 0)
+          ufo.outlines.add_contour();
+        int type = j % options.contour_points ? point_type() : 3;
+        if (has_replacements and type and j % 8 == 0)
+          ufo.outlines.add_point(number(), number(), type, rng() % 2, (int) j);
+        else
+          ufo.outlines.add_point(number(), number(), type, type ? rng() % 2 : 0);
+        }
+      glif.outline.end = ufo.outlines.contours.size();
+      glif.len_points = options.points;
+      ufo.contours[i] = glif.outline;
+      }
+
+    ufo.glifs.push_back(std::move(glif));
+    }
+  }
@@ -41,6 +41,12 @@ def report_times(times, ufoz=0):
     f'  {time_str(times.fontinfo)} (fontinfo)'
     )
 
+def report_threads(threads):
+  return ''.join(
+    f'\n  thread {i}: {time_str(busy)} busy, {time_str(idle)} idle ({items} glifs)'
+    for i, (busy, idle, items) in enumerate(threads)
+    )
+
 def finish(ufo, instance=0):
 
   if instance:
@@ -64,7 +70,8 @@ def finish(ufo, instance=0):
       return
 
     print(f'\n{filename} completed {total_time}:\n'
-      f'{report_times(ufo.instance_times, ufo.opts.ufoz)}')
+      f'{report_times(ufo.instance_times, ufo.opts.ufoz)}'
+      f'{report_threads(ufo.instance_times.glif_threads)}')
 
     ufo.total_times.glifs += ufo.instance_times.glifs
     ufo.total_times.features += ufo.instance_times.features
@@ -235,11 +235,11 @@ def build_instance_paths(ufo, attributes, path):
 
   if ufo.opts.ufoz:
     ufo.paths.instance.ufo = ufo_path = os_path_basename(path)
-    if ufo.opts.force_overwrite and os_path_isfile(ufo.paths.instance.ufoz):
+    if ufo.opts.force_overwrite and not ufo.opts.incremental and os_path_isfile(ufo.paths.instance.ufoz):
       remove_path(ufo.paths.instance.ufoz, force=1)
   else:
     ufo.paths.instance.ufo = ufo_path = path
-    if ufo.opts.force_overwrite and os_path_isdir(ufo.paths.instance.ufo):
+    if ufo.opts.force_overwrite and not ufo.opts.incremental and os_path_isdir(ufo.paths.instance.ufo):
       remove_path(ufo.paths.instance.ufo, force=1)
 
   ufo.paths.instance.glyphs = glyphs = os_path_join(ufo_path, 'glyphs')